@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sstream>
+
+/**
+@brief The tied weights that define the proposed network. Every hidden neuron shares wa, wb, wc
+and every output triplet shares wd, we, wf, so these values are the whole chromosome of a network.
+*/
+struct BinaryData
+{
+    float wa;
+    float wb;
+    float wc;
+    float wd;
+    float we;
+    float wf;
+
+    uint32_t first_layer_neurons;
+
+    std::string to_string()
+    {
+        return  std::to_string(wa) + "&" +
+                std::to_string(wb) + "&" +
+                std::to_string(wc) + "&" +
+                std::to_string(wd) + "&" +
+                std::to_string(we) + "&" +
+                std::to_string(wf) + "&" +
+                std::to_string(first_layer_neurons);
+                            
+    }
+
+    void read(std::string s)
+    {
+        std::stringstream test(s);
+        std::string segment;
+        std::vector<std::string> collection;
+
+        while (std::getline(test, segment, '&'))
+        {
+            collection.push_back(segment);
+        }
+
+        wa = std::stof(collection[0]);
+        wb = std::stof(collection[1]);
+        wc = std::stof(collection[2]);
+        wd = std::stof(collection[3]);
+        we = std::stof(collection[4]);
+        wf = std::stof(collection[5]);
+        first_layer_neurons = std::stoul(collection[6]);        
+    }
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+@brief Appends values to the payload of a checkpoint. The values are stored with the byte order of the machine,
+a checkpoint is meant to be resumed where it was written
+*/
+class CheckpointWriter
+{
+private:
+
+    std::vector<uint8_t>& bytes;
+
+public:
+
+    /**
+    @brief Creates a writer
+    @param bytes The payload the values are appended to
+    */
+    explicit CheckpointWriter(std::vector<uint8_t>& bytes) : bytes{bytes}
+    {
+    }
+
+    /**
+    @brief Appends a value
+    @param value The value, trivially copyable
+    */
+    template <class T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+
+        const size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(T));
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    /**
+    @brief Appends the size of a collection and its values
+    @param values The collection
+    */
+    template <class T>
+    void write_vector(const std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+
+        write(uint64_t(values.size()));
+
+        const size_t offset = bytes.size();
+        bytes.resize(offset + values.size() * sizeof(T));
+
+        if (!values.empty())
+        {
+            std::memcpy(bytes.data() + offset, values.data(), values.size() * sizeof(T));
+        }
+    }
+};
+
+/**
+@brief Reads the values of the payload of a checkpoint in the order they were written. A read past the end fails
+and every later read fails too, so a sequence of reads can be checked once at the end
+*/
+class CheckpointReader
+{
+private:
+
+    const std::vector<uint8_t>& bytes;
+    size_t offset = 0;
+    bool failed = false;
+
+public:
+
+    /**
+    @brief Creates a reader
+    @param bytes The payload
+    */
+    explicit CheckpointReader(const std::vector<uint8_t>& bytes) : bytes{bytes}
+    {
+    }
+
+    /**
+    @brief Reads a value
+    @param value The value read, unchanged if the read fails
+    @return False if the payload has no more values
+    */
+    template <class T>
+    bool read(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read");
+
+        if (failed || bytes.size() - offset < sizeof(T))
+        {
+            failed = true;
+            return false;
+        }
+
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        offset += sizeof(T);
+
+        return true;
+    }
+
+    /**
+    @brief Reads a collection written with CheckpointWriter::write_vector
+    @param values The collection read
+    @return False if the payload does not hold the collection
+    */
+    template <class T>
+    bool read_vector(std::vector<T>& values)
+    {
+        uint64_t count = 0;
+
+        if (!read(count) || count > (bytes.size() - offset) / sizeof(T))
+        {
+            failed = true;
+            return false;
+        }
+
+        values.resize(size_t(count));
+
+        if (count > 0)
+        {
+            std::memcpy(values.data(), bytes.data() + offset, size_t(count) * sizeof(T));
+        }
+
+        offset += size_t(count) * sizeof(T);
+
+        return true;
+    }
+
+    /**
+    @brief Checks if every read succeeded and the whole payload was read
+    @return True if the payload was read exactly
+    */
+    bool is_complete() const
+    {
+        return !failed && offset == bytes.size();
+    }
+
+    /**
+    @brief Checks if every read succeeded
+    @return True if no read failed
+    */
+    bool is_valid() const
+    {
+        return !failed;
+    }
+};
+
+/**
+@brief Binary snapshot file of a training run. The file is a 24 byte header (magic, version, payload size and
+FNV-1a hash of the payload) followed by the payload. It is written to a temporary file that replaces the previous
+snapshot once complete, so a crash while writing leaves the previous snapshot intact. The write runs on a thread
+of its own: the payload is built by the caller, which only waits for the previous write, if still running.
+*/
+class Checkpoint
+{
+public:
+
+    static constexpr uint32_t magic = 0x4B434E4E;  //< "NNCK"
+    static constexpr uint32_t version = 2;
+
+private:
+
+    struct WriteResult
+    {
+        bool saved = false;
+        double milliseconds = 0.0;
+    };
+
+    std::future<WriteResult> pending;               //< The write in progress
+    uint64_t written = 0;
+    uint64_t failed = 0;
+    double last_write_milliseconds = 0.0;
+
+public:
+
+    Checkpoint() = default;
+
+    /**
+    @brief Waits for the write in progress
+    */
+    ~Checkpoint()
+    {
+        wait();
+    }
+
+    /**
+    @brief Starts writing a snapshot. Waits for the previous write first, so there is never more than one
+    @param path The path of the snapshot
+    @param payload The payload, moved to the writing thread
+    */
+    void save_async(const std::string& path, std::vector<uint8_t>&& payload);
+
+    /**
+    @brief Waits for the write in progress, if any
+    @return False if the last write failed
+    */
+    bool wait();
+
+    /**
+    @brief Reads a snapshot and checks its header and hash
+    @param path The path of the snapshot
+    @param payload The payload read
+    @return False if the file is missing, of another version or damaged
+    */
+    static bool load(const std::string& path, std::vector<uint8_t>& payload);
+
+    /**
+    @brief Gets the amount of snapshots written since the checkpoint was created, the one in progress excluded
+    @return The amount of snapshots
+    */
+    uint64_t get_written_count() const
+    {
+        return written;
+    }
+
+    /**
+    @brief Gets the amount of snapshots that could not be written
+    @return The amount of snapshots
+    */
+    uint64_t get_failed_count() const
+    {
+        return failed;
+    }
+
+    /**
+    @brief Gets the time the last completed write took on its thread
+    @return The time in milliseconds
+    */
+    double get_last_write_time() const
+    {
+        return last_write_milliseconds;
+    }
+
+private:
+
+    /**
+    @brief Writes a snapshot to a temporary file and replaces the previous one with it
+    @param path The path of the snapshot
+    @param payload The payload
+    @return True if the snapshot was replaced
+    */
+    static bool write(const std::string& path, const std::vector<uint8_t>& payload);
+
+    /**
+    @brief FNV-1a hash of a payload
+    @param payload The payload
+    @return The hash
+    */
+    static uint64_t hash(const std::vector<uint8_t>& payload);
+};
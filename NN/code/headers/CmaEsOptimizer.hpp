@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Optimizer.hpp>
+
+/**
+@brief Covariance matrix adaptation evolution strategy. Samples each generation from a normal distribution around
+a mean and moves the mean to the weighted best half of the samples, adapting the covariance and the step size
+from the successful steps. With 6 genes the whole 6x6 covariance is adapted and decomposed every generation.
+The default settings of Hansen's tutorial are used, with the population size of the batch given. The first ask
+evaluates the given population and the mean starts at its best chromosome, so the search does not start where the
+ReLU of every pixel is off.
+*/
+class CmaEsOptimizer : public Optimizer
+{
+private:
+
+    typedef std::array<double, genes> Vector;
+    typedef std::array<double, genes * genes> Matrix;
+
+    size_t samples;                         //< lambda, the chromosomes of each ask
+    size_t parents;                         //< mu, the best chromosomes that move the mean
+    std::vector<double> weights;
+    double effective_parents;
+
+    double sigma_learning_rate;             //< c_sigma
+    double sigma_damping;                   //< d_sigma
+    double path_learning_rate;              //< c_c
+    double rank_one_learning_rate;          //< c_1
+    double rank_parents_learning_rate;      //< c_mu
+    double expected_norm;                   //< E|N(0, I)|
+
+    Vector mean;
+    double sigma;
+    Matrix covariance {};
+    Matrix basis {};                        //< Eigenvectors of the covariance, one per column
+    Vector scales {};                       //< Square roots of the eigenvalues
+    Vector sigma_path {};
+    Vector covariance_path {};
+    uint64_t generation = 0;
+
+    std::vector<Vector> steps;              //< The normalised steps of the last ask
+    std::vector<float> population;          //< The first population, until it is evaluated
+
+public:
+
+    /**
+    @brief Creates the optimizer. The spread of the population is the first step size
+    @param population The first population, 6 weights per chromosome. Its size is the size of every ask
+    */
+    explicit CmaEsOptimizer(const std::vector<float>& population);
+
+    const char* get_name() const override
+    {
+        return "cmaes";
+    }
+
+    /**
+    @brief Samples a generation around the mean, or gets the first population while it is not evaluated
+    @param chromosomes Filled with 6 weights per chromosome
+    */
+    void ask(std::vector<float>& chromosomes) override;
+
+    /**
+    @brief The best half moves the mean and adapts the covariance
+    @param candidates The amount of chromosomes of the batch
+    @return The amount of chromosomes
+    */
+    size_t get_selected_count(size_t candidates) const override
+    {
+        return parents < candidates ? parents : candidates;
+    }
+
+    /**
+    @brief The adaptation needs the ranking of unbiased samples, the chromosomes screened out by a surrogate
+    model would bias it
+    @return False
+    */
+    bool accepts_screening() const override
+    {
+        return false;
+    }
+
+    /**
+    @brief The adaptation uses the steps the chromosomes of the batch were sampled with, a replaced chromosome has
+    none
+    @return False
+    */
+    bool accepts_migrants() const override
+    {
+        return false;
+    }
+
+protected:
+
+    /**
+    @brief Moves the mean and adapts the covariance and the step size
+    @param chromosomes The chromosomes of the last ask
+    @param fitness The fitness of each chromosome
+    */
+    void update(const std::vector<float>& chromosomes, const std::vector<float>& fitness) override;
+
+    /**
+    @brief Writes the distribution, the evolution paths and the first population while it is not evaluated. The
+    steps of the last ask are not needed between a tell and the next ask
+    @param writer The payload of the checkpoint
+    */
+    void save_state(CheckpointWriter& writer) const override;
+
+    /**
+    @brief Restores the distribution, the evolution paths and the first population
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold the state
+    */
+    bool load_state(CheckpointReader& reader) override;
+
+private:
+
+    /**
+    @brief Decomposes the covariance in basis and scales
+    */
+    void decompose();
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+@brief Table of the distinct pixels of an image: each input colour with its desired colour and the amount of
+pixels that have both. The network works pixel by pixel and the fitness is a sum over the pixels, so a pass
+over the table with the counts as weights gives the fitness and the gradients of the whole image.
+The entries are in the order the colours first appear in the image, so the table of an image is always the same.
+*/
+class ColorHistogram
+{
+private:
+
+    std::vector<float> input;       //< Three values per colour
+    std::vector<float> desired;     //< Three values per colour
+    std::vector<float> counts;      //< Pixels of each colour
+
+    size_t pixels = 0;
+
+public:
+
+    /**
+    @brief Builds the table of an image
+    @param image_input The input values of the image, three per pixel
+    @param image_desired The desired values of the image, three per pixel
+    */
+    void build(const std::vector<float>& image_input, const std::vector<float>& image_desired);
+
+    /**
+    @brief Builds the table of an image read in place, as the planes of the dataset cache
+    @param image_input The input values of the image, three per pixel
+    @param image_desired The desired values of the image, three per pixel
+    @param pixels_count The amount of pixels
+    */
+    void build(const float* image_input, const float* image_desired, size_t pixels_count);
+
+    /**
+    @brief Gets the input values of the colours
+    @return Three values per colour
+    */
+    const std::vector<float>& get_input() const
+    {
+        return input;
+    }
+
+    /**
+    @brief Gets the desired values of the colours
+    @return Three values per colour
+    */
+    const std::vector<float>& get_desired() const
+    {
+        return desired;
+    }
+
+    /**
+    @brief Gets the amount of pixels of each colour
+    @return One count per colour
+    */
+    const std::vector<float>& get_counts() const
+    {
+        return counts;
+    }
+
+    /**
+    @brief Gets the amount of colours of the table
+    @return The amount of colours
+    */
+    size_t get_colors_count() const
+    {
+        return counts.size();
+    }
+
+    /**
+    @brief Gets the amount of pixels of the image
+    @return The amount of pixels
+    */
+    size_t get_pixels_count() const
+    {
+        return pixels;
+    }
+
+    /**
+    @brief Gets how many pixels each colour stands for on average
+    @return The pixels divided by the colours
+    */
+    double get_compression_ratio() const
+    {
+        return counts.empty() ? 1.0 : double(pixels) / counts.size();
+    }
+};
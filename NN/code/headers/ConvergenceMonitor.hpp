@@ -0,0 +1,147 @@
+#pragma once
+
+#include <Checkpoint.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+@brief Early stopping of a training run. Each step gives the best and the mean fitness (or error) of the run; both
+are smoothed with a moving average over a window of steps and compared with their average one window earlier. A
+step where neither improved by the minimum relative improvement is a stalled step, and patience stalled steps in a
+row stop the run. A best fitness at the target stops it at once. The monitor records why and when the run stopped.
+*/
+class ConvergenceMonitor
+{
+public:
+
+    enum reasons {RUNNING, STALLED, TARGET_REACHED, STEP_LIMIT};
+
+    struct Settings
+    {
+        uint32_t window = 20;               //< Steps of the moving averages
+        uint32_t patience = 0;              //< Stalled steps in a row that stop the run, 0 never stops it
+        float minimum_improvement = 0.001f; //< Relative improvement of an average over a window that is not a stall
+        float target = 0.f;                 //< A best fitness at or below it stops the run
+    };
+
+    /**
+    @brief How a run ended
+    */
+    struct Stop
+    {
+        reasons reason = RUNNING;
+        uint64_t step = 0;                  //< Steps given until the run stopped
+        float best = 0.f;                   //< The last best fitness given
+        float best_improvement = 0.f;       //< Relative improvement of the average best over the last window
+        float mean_improvement = 0.f;       //< Relative improvement of the average mean over the last window
+    };
+
+private:
+
+    Settings settings;
+
+    std::vector<float> best_history;        //< The last two windows of best fitness
+    std::vector<float> mean_history;
+    uint64_t steps = 0;
+    uint32_t stalled = 0;
+
+    Stop stop;
+
+public:
+
+    /**
+    @brief Creates a monitor
+    @param settings The window, the patience and the thresholds
+    */
+    explicit ConvergenceMonitor(const Settings& settings) : settings{settings}
+    {
+        if (this->settings.window == 0)
+        {
+            this->settings.window = 1;
+        }
+    }
+
+    /**
+    @brief Gets the name of a reason to stop
+    @param reason The reason
+    @return The name
+    */
+    static const char* get_reason_name(reasons reason);
+
+    /**
+    @brief Starts a new run
+    */
+    void reset();
+
+    /**
+    @brief Adds the fitness of a step and checks if the run stops
+    @param best The best fitness of the step, lower is better
+    @param mean The mean fitness of the step
+    @return True if the run stops with this step
+    */
+    bool update(float best, float mean);
+
+    /**
+    @brief Records that the run ended by itself, after every step it had
+    */
+    void finish();
+
+    /**
+    @brief Checks if the run stopped
+    @return True once update returned true
+    */
+    bool has_stopped() const
+    {
+        return stop.reason == STALLED || stop.reason == TARGET_REACHED;
+    }
+
+    /**
+    @brief Gets how the run ended, or the last step while it runs
+    @return The stop record
+    */
+    const Stop& get_stop() const
+    {
+        return stop;
+    }
+
+    /**
+    @brief Gets the stalled steps in a row
+    @return The amount of steps
+    */
+    uint32_t get_stalled_steps() const
+    {
+        return stalled;
+    }
+
+    /**
+    @brief Gets the settings of the monitor
+    @return The settings
+    */
+    const Settings& get_settings() const
+    {
+        return settings;
+    }
+
+    /**
+    @brief Writes the state of the run to a checkpoint
+    @param writer The payload of the checkpoint
+    */
+    void save(CheckpointWriter& writer) const;
+
+    /**
+    @brief Restores the state written by save
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold the state
+    */
+    bool load(CheckpointReader& reader);
+
+private:
+
+    /**
+    @brief Gets the relative improvement of the average of the last window of a history over the window before
+    @param history The last two windows of a fitness
+    @return The improvement, positive when the fitness went down
+    */
+    float get_improvement(const std::vector<float>& history) const;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <qfile.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+@brief The training set decoded once into a single binary file that the trainers map in memory. Every image has
+its pixels as 8 bit RGB, the values the PNG holds, as the LUV floats extract_input_from_image gives and the desired
+values of every target, all interleaved by pixel as the networks read them. The file starts with a header and an
+index of the images, with the size and modification time of each PNG so a changed training set compiles the file
+again, and its hash so only the changed images are decoded again. The planes are read in place from the mapping,
+the PNG decoder is only used by compile.
+*/
+class DatasetCache
+{
+public:
+
+    static constexpr uint32_t magic = 0x53444E4E;  //< "NNDS"
+    static constexpr uint32_t version = 2;
+    static constexpr uint64_t alignment = 64;      //< Of every plane in the file
+
+    /**
+    @brief The desired values of the trainings. The LMS daltonization has one per impairment, the RGB
+    daltonization is the same for all of them
+    */
+    enum targets {LMS_DEUTERANOPIA, LMS_PROTANOPIA, LMS_TRITANOPIA, RGB_DALTONIZATION};
+    static constexpr uint32_t targets_count = 4;
+
+    struct Entry
+    {
+        uint64_t rgb_offset;                        //< 3 bytes per pixel, the planes of the image follow it
+        uint64_t luv_offset;                        //< 3 floats per pixel
+        uint64_t target_offsets[targets_count];     //< 3 floats per pixel
+        uint32_t width;
+        uint32_t height;
+        uint64_t source_size;                       //< Size of the PNG the image was decoded from
+        int64_t source_time;                        //< Last modification of the PNG, in ticks of the file clock
+        uint64_t source_hash;                       //< FNV-1a hash of the PNG
+    };
+
+private:
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;                             //< Images
+        uint32_t reserved;
+    };
+
+    QFile file;
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+    const Entry* entries = nullptr;
+    uint32_t count = 0;
+
+public:
+
+    DatasetCache() = default;
+
+    DatasetCache(const DatasetCache&) = delete;
+    DatasetCache& operator = (const DatasetCache&) = delete;
+
+    /**
+    @brief Unmaps the file
+    */
+    ~DatasetCache()
+    {
+        close();
+    }
+
+    /**
+    @brief Writes the file of the images 0.png, 1.png... of a folder, as many as there are. The images run on
+    every thread of the pool, and the planes of an image whose PNG has the hash it had in the previous file are
+    copied from it instead of decoded again. The file is written next to its path and renamed once complete
+    @param folder The folder of the images, ending with a separator
+    @param path The path of the file
+    @param decoded The amount of images decoded
+    @return The amount of images, 0 if the file could not be written
+    */
+    static uint32_t compile(const std::string& folder, const std::string& path, uint32_t& decoded);
+
+    /**
+    @brief Checks if a file holds every image of a folder as it is now, from its index and the PNG files only
+    @param folder The folder of the images, ending with a separator
+    @param path The path of the file
+    @return False if the file is missing, of another version or the images changed
+    */
+    static bool is_current(const std::string& folder, const std::string& path);
+
+    /**
+    @brief Maps a file in memory
+    @param path The path of the file
+    @return False if the file is missing, of another version or damaged
+    */
+    bool open(const std::string& path);
+
+    /**
+    @brief Unmaps the file, the planes given before are no longer valid
+    */
+    void close();
+
+    /**
+    @brief Checks if a file is mapped
+    @return True if the images can be read
+    */
+    bool is_open() const
+    {
+        return data != nullptr;
+    }
+
+    /**
+    @brief Gets the amount of images
+    @return The amount of images
+    */
+    uint32_t get_count() const
+    {
+        return count;
+    }
+
+    /**
+    @brief Gets the amount of pixels of an image
+    @param index The image
+    @return The width times the height
+    */
+    size_t get_pixels_count(uint32_t index) const
+    {
+        return size_t(entries[index].width) * entries[index].height;
+    }
+
+    /**
+    @brief Gets the width of an image
+    @param index The image
+    @return The width in pixels
+    */
+    uint32_t get_width(uint32_t index) const
+    {
+        return entries[index].width;
+    }
+
+    /**
+    @brief Gets the height of an image
+    @param index The image
+    @return The height in pixels
+    */
+    uint32_t get_height(uint32_t index) const
+    {
+        return entries[index].height;
+    }
+
+    /**
+    @brief Gets the RGB plane of an image, in the mapping
+    @param index The image
+    @return 3 bytes per pixel
+    */
+    const uint8_t* get_rgb(uint32_t index) const
+    {
+        return data + entries[index].rgb_offset;
+    }
+
+    /**
+    @brief Gets the LUV plane of an image, in the mapping
+    @param index The image
+    @return 3 floats per pixel
+    */
+    const float* get_luv(uint32_t index) const
+    {
+        return reinterpret_cast<const float*>(data + entries[index].luv_offset);
+    }
+
+    /**
+    @brief Gets the desired values of an image for a target, in the mapping
+    @param index The image
+    @param target The target
+    @return 3 floats per pixel
+    */
+    const float* get_target(uint32_t index, targets target) const
+    {
+        return reinterpret_cast<const float*>(data + entries[index].target_offsets[target]);
+    }
+
+private:
+
+    /**
+    @brief Gets the path of an image of a folder
+    @param folder The folder of the images
+    @param index The image
+    @return The path of the PNG
+    */
+    static std::string get_image_path(const std::string& folder, uint32_t index)
+    {
+        return folder + std::to_string(index) + ".png";
+    }
+
+    /**
+    @brief Gets the size of the planes of an image in the file, each one aligned
+    @param pixels The amount of pixels of the image
+    @return The size in bytes
+    */
+    static uint64_t get_planes_size(uint64_t pixels)
+    {
+        return align(pixels * 3) + align(pixels * 3 * sizeof(float)) * (1 + targets_count);
+    }
+
+    /**
+    @brief Rounds a size up to the alignment of the planes
+    @param size The size
+    @return The aligned size
+    */
+    static uint64_t align(uint64_t size)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+    @brief Sets the offsets of the planes of an image
+    @param entry The entry of the image, with its size
+    @param offset The offset of the first plane
+    */
+    static void set_offsets(Entry& entry, uint64_t offset);
+
+    /**
+    @brief Decodes an image and computes its planes
+    @param image_path The path of the PNG
+    @param entry The entry of the image, its offsets are relative to the planes
+    @param planes The planes
+    */
+    static void decode_image(const std::string& image_path, Entry& entry, std::vector<uint8_t>& planes);
+
+    /**
+    @brief FNV-1a hash of a file
+    @param path The path of the file
+    @param hash The hash
+    @return False if the file can not be read
+    */
+    static bool hash_file(const std::string& path, uint64_t& hash);
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Optimizer.hpp>
+
+/**
+@brief Differential evolution, DE/rand/1/bin. Each chromosome of the population gets a trial made of another
+chromosome plus the scaled difference of two more, crossed over gene by gene with it, and is replaced by the trial
+when the trial is not worse. The first ask, and the first after reset_fitness, evaluates the population itself.
+With rescoring, every ask gives the trials followed by their targets, so both are compared on the same batch.
+*/
+class DifferentialEvolutionOptimizer : public Optimizer
+{
+private:
+
+    static constexpr float differential_weight = 0.7f;     //< F
+    static constexpr float crossover_probability = 0.9f;   //< CR
+
+    std::vector<float> population;
+    std::vector<float> population_fitness;
+    bool evaluated = false;                                 //< False while the fitness of the population is unknown
+    bool rescoring = false;                                 //< The targets are scored again with their trials
+
+public:
+
+    /**
+    @brief Creates the optimizer
+    @param population The first population, 6 weights per chromosome
+    */
+    explicit DifferentialEvolutionOptimizer(const std::vector<float>& population) : population{population}
+    {
+    }
+
+    const char* get_name() const override
+    {
+        return "de";
+    }
+
+    /**
+    @brief Gets the trials of the population, or the population itself when its fitness is unknown
+    @param chromosomes Filled with 6 weights per chromosome
+    */
+    void ask(std::vector<float>& chromosomes) override;
+
+    /**
+    @brief Every trial is compared with its own target, so every fitness must be exact
+    @param candidates The amount of chromosomes of the batch
+    @return The amount of chromosomes
+    */
+    size_t get_selected_count(size_t candidates) const override
+    {
+        return candidates;
+    }
+
+    /**
+    @brief Forgets the fitness values known, the population is evaluated again by the next ask
+    */
+    void reset_fitness() override
+    {
+        Optimizer::reset_fitness();
+        evaluated = false;
+    }
+
+    /**
+    @brief Scores the targets again with their trials, the fitness they kept from another batch can not be
+    compared with the one of the trials
+    @param rescoring True if the fitness changes from one tell to the next
+    */
+    void set_rescoring(bool rescoring) override
+    {
+        this->rescoring = rescoring;
+    }
+
+protected:
+
+    /**
+    @brief Replaces the chromosomes whose trial is not worse
+    @param chromosomes The chromosomes of the last ask
+    @param fitness The fitness of each chromosome
+    */
+    void update(const std::vector<float>& chromosomes, const std::vector<float>& fitness) override;
+
+    /**
+    @brief Writes the population and its fitness
+    @param writer The payload of the checkpoint
+    */
+    void save_state(CheckpointWriter& writer) const override;
+
+    /**
+    @brief Restores the population and its fitness
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold a population of the same size
+    */
+    bool load_state(CheckpointReader& reader) override;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Checkpoint.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+@brief Memo table of the fitness of the chromosomes of a run, keyed by the exact bits of the 6 weights, the image
+and the evaluation type. The recombination copies parent genes most of the time, so many children of a generation
+are copies of a parent or of each other; their fitness is taken from the table instead of evaluated again.
+The fitness of a chromosome does not depend on the rest of the population nor on the threads, so a hit gives the
+value an evaluation would.
+*/
+class FitnessCache
+{
+public:
+
+    static constexpr size_t genes = 6;
+
+    struct Key
+    {
+        std::array<uint32_t, genes> weights;    //< Bits of wa, wb, wc, wd, we, wf
+        uint32_t dataset;                       //< The image the fitness was measured on
+        uint32_t evaluation;                    //< The evaluation and impairment that gave the desired values
+
+        bool operator == (const Key& other) const
+        {
+            return weights == other.weights && dataset == other.dataset && evaluation == other.evaluation;
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        float fitness;
+    };
+
+private:
+
+    struct KeyHash
+    {
+        size_t operator () (const Key& key) const;
+    };
+
+    std::unordered_map<Key, float, KeyHash> table;
+
+    std::unordered_map<Key, size_t, KeyHash> pending_slots;     //< Chromosomes to evaluate of the current lookup
+    std::vector<Key> pending_keys;
+    std::vector<std::pair<size_t, size_t>> pending_candidates;  //< Candidate and pending slot of every miss
+
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+
+public:
+
+    /**
+    @brief Creates a key
+    @param chromosome The 6 weights of the chromosome
+    @param dataset The image the fitness is measured on
+    @param evaluation The evaluation and impairment that give the desired values
+    @return The key
+    */
+    static Key make_key(const float* chromosome, uint32_t dataset, uint32_t evaluation);
+
+    /**
+    @brief Looks up the fitness of a population. The fitness of the chromosomes in the table is written and the
+    distinct chromosomes missing are copied to pending, to be evaluated and passed to store
+    @param chromosomes The first weight of the matrix. 6 weights per candidate
+    @param candidates The amount of candidates
+    @param dataset The image the fitness is measured on
+    @param evaluation The evaluation and impairment that give the desired values
+    @param fitness The first fitness. One per candidate, only the hits are written
+    @param pending The chromosomes to evaluate, 6 weights per chromosome
+    @return The amount of chromosomes to evaluate
+    */
+    size_t lookup(const float* chromosomes, size_t candidates, uint32_t dataset, uint32_t evaluation, float* fitness, std::vector<float>& pending);
+
+    /**
+    @brief Adds the fitness of the chromosomes given by the last lookup to the table and writes the fitness of
+    every candidate that missed
+    @param pending_fitness The fitness of the pending chromosomes, in the order of the lookup
+    @param pending_complete 1 for the fitness values to store, 0 for partial values that are only written
+    @param fitness The first fitness of the candidates of the last lookup
+    */
+    void store(const float* pending_fitness, const uint8_t* pending_complete, float* fitness);
+
+    /**
+    @brief Writes the fitness values stored to a checkpoint, so a resumed run evaluates the chromosomes the run
+    would have evaluated
+    @param writer The payload of the checkpoint
+    */
+    void save(CheckpointWriter& writer) const;
+
+    /**
+    @brief Replaces the fitness values stored with the ones written by save
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold the values
+    */
+    bool load(CheckpointReader& reader);
+
+    /**
+    @brief Forgets the fitness values stored, when no later lookup can hit them. The hit rate is kept
+    */
+    void clear()
+    {
+        table.clear();
+    }
+
+    /**
+    @brief Gets the fraction of the lookups that did not need an evaluation since the cache was created
+    @return The hit rate in [0, 1]
+    */
+    double get_hit_rate() const
+    {
+        return lookups > 0 ? double(hits) / lookups : 0.0;
+    }
+
+    /**
+    @brief Gets the amount of fitness values stored
+    @return The amount of entries
+    */
+    size_t get_size() const
+    {
+        return table.size();
+    }
+};
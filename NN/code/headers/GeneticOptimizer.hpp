@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Optimizer.hpp>
+
+/**
+@brief The genetic algorithm of the original training: the two best chromosomes of a generation are the parents
+of the whole next generation, each gene copied from one of them with 45% probability each or re-randomised in
+[-5, 5) with 10% probability.
+*/
+class GeneticOptimizer : public Optimizer
+{
+private:
+
+    std::vector<float> population;
+
+public:
+
+    /**
+    @brief Creates the optimizer
+    @param population The first population, 6 weights per chromosome
+    */
+    explicit GeneticOptimizer(const std::vector<float>& population) : population{population}
+    {
+    }
+
+    const char* get_name() const override
+    {
+        return "genetic";
+    }
+
+    /**
+    @brief Gets the current population
+    @param chromosomes Filled with 6 weights per chromosome
+    */
+    void ask(std::vector<float>& chromosomes) override
+    {
+        chromosomes = population;
+    }
+
+    /**
+    @brief Only the two parents are selected
+    @param candidates The amount of chromosomes of the batch
+    @return The amount of chromosomes
+    */
+    size_t get_selected_count(size_t candidates) const override
+    {
+        return candidates < 2 ? candidates : 2;
+    }
+
+protected:
+
+    /**
+    @brief Recombines the population from its two best chromosomes
+    @param chromosomes The chromosomes of the last ask
+    @param fitness The fitness of each chromosome
+    */
+    void update(const std::vector<float>& chromosomes, const std::vector<float>& fitness) override;
+
+    /**
+    @brief Writes the population
+    @param writer The payload of the checkpoint
+    */
+    void save_state(CheckpointWriter& writer) const override
+    {
+        writer.write_vector(population);
+    }
+
+    /**
+    @brief Restores the population
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold a population of the same size
+    */
+    bool load_state(CheckpointReader& reader) override
+    {
+        std::vector<float> saved;
+
+        if (!reader.read_vector(saved) || saved.size() != population.size())
+        {
+            return false;
+        }
+
+        population = std::move(saved);
+
+        return true;
+    }
+
+private:
+
+    /**
+    @brief Recombine the given weights and mutate if needed
+    @param parent_1_value The value of the first parent
+    @param parent_2_value The value of the second parent
+    @return The new value
+    */
+    static float recombine_weight(float parent_1_value, float parent_2_value);
+};
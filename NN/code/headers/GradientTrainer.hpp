@@ -0,0 +1,135 @@
+#pragma once
+
+#include <TiedNeuralNetwork.hpp>
+#include <ColorHistogram.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+@brief Mini-batch gradient descent over the tied weights of a network.
+The gradients of several images are accumulated before each update, which is done with SGD with momentum
+or Adam and a learning rate that follows a schedule. The gradients are the ones of TiedNeuralNetwork::compute_gradients,
+the same ones the plain step of TiedNeuralNetwork::back_propagation uses.
+*/
+class GradientTrainer
+{
+public:
+
+    enum optimizers {SGD_MOMENTUM, ADAM};
+
+    /**
+    @brief CONSTANT keeps the learning rate, STEP_DECAY multiplies it by decay every decay_steps updates and
+    COSINE anneals it from learning_rate to minimum_learning_rate over total_steps updates
+    */
+    enum schedules {CONSTANT, STEP_DECAY, COSINE};
+
+    struct Settings
+    {
+        optimizers optimizer = ADAM;
+        schedules schedule = COSINE;
+
+        float learning_rate = 0.05f;
+        float minimum_learning_rate = 0.001f;
+        float momentum = 0.9f;              //< SGD_MOMENTUM only
+        float beta1 = 0.9f;                 //< ADAM only
+        float beta2 = 0.999f;               //< ADAM only
+        float epsilon = 1e-8f;              //< ADAM only
+        float decay = 0.5f;                 //< STEP_DECAY only
+        uint32_t decay_steps = 50;          //< STEP_DECAY only
+        uint32_t total_steps = 100;         //< COSINE only
+
+        uint32_t batch_size = 8;            //< Images accumulated before each update
+    };
+
+private:
+
+    TiedNeuralNetwork& network;
+    Settings settings;
+
+    TiedNeuralNetwork::Scratch scratch;
+    std::vector<float> outputs;
+
+    std::array<double, 6> parameters;       //< The weights in double precision, the network keeps them rounded
+    std::array<double, 6> gradients {};     //< Sum of the gradients of the batch
+    std::array<double, 6> first_moments {}; //< Velocity of SGD_MOMENTUM or first moment of ADAM
+    std::array<double, 6> second_moments {};
+
+    double batch_error = 0.0;
+    uint64_t batch_pixels = 0;
+    uint32_t batch_images = 0;
+    uint32_t steps = 0;
+
+public:
+
+    /**
+    @brief Creates a trainer for a network
+    @param network The network to train. The trainer changes its weights on every update
+    @param settings The optimizer, schedule and batch settings
+    */
+    GradientTrainer(TiedNeuralNetwork& network, const Settings& settings);
+
+    /**
+    @brief Runs an image through the network and adds its gradients to the current batch
+    @param inputs The input values, three per pixel
+    @param desired The desired values, three per pixel
+    @return The mean error per pixel of the image before the update
+    */
+    double accumulate(const std::vector<float>& inputs, const std::vector<float>& desired);
+
+    /**
+    @brief Runs the colour table of an image through the network and adds its gradients, weighted by the amount
+    of pixels of each colour, to the current batch. Same gradients as the whole image
+    @param histogram The colour table of the image
+    @return The mean error per pixel of the image before the update
+    */
+    double accumulate(const ColorHistogram& histogram);
+
+    /**
+    @brief Checks if the batch has the amount of images of the settings
+    @return True if the batch is full
+    */
+    bool is_batch_full() const
+    {
+        return batch_images >= settings.batch_size;
+    }
+
+    /**
+    @brief Checks if there are images accumulated since the last update
+    @return True if an update can be done
+    */
+    bool has_pending_images() const
+    {
+        return batch_images > 0;
+    }
+
+    /**
+    @brief Updates the weights of the network with the mean gradient of the batch and starts a new batch
+    @return The mean error per pixel of the batch
+    */
+    double step();
+
+    /**
+    @brief Gets the learning rate the schedule gives for the next update
+    @return The learning rate
+    */
+    double get_learning_rate() const;
+
+    /**
+    @brief Gets the amount of updates done
+    @return The amount of updates
+    */
+    uint32_t get_steps() const
+    {
+        return steps;
+    }
+
+private:
+
+    /**
+    @brief Adds the gradients of an image to the current batch
+    @param image The gradients of the image
+    @return The mean error per pixel of the image
+    */
+    double add_gradients(const TiedNeuralNetwork::Gradients& image);
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <qsharedmemory.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+@brief Migration between the islands of an island model genetic training. Every island is a process of its own
+with its own population; every few generations it publishes its best chromosomes to its slot of a shared memory
+mailbox and takes the ones its neighbours published in theirs. Each slot has a single writer and is guarded by a
+sequence lock: the writer makes the sequence odd while it writes and even once done, a reader copies the slot and
+copies it again if the sequence changed meanwhile. No island ever waits for another one.
+*/
+class IslandModel
+{
+public:
+
+    static constexpr size_t genes = 6;
+    static constexpr size_t max_migrants = 16;
+
+    enum topologies {RING, ALL};            //< From the previous island only, or from every other island
+
+    struct Settings
+    {
+        uint32_t islands = 1;
+        uint32_t island = 0;                //< This island, 0 is the one that launches the others
+        uint32_t interval = 10;             //< Generations between two migrations, 0 never migrates
+        uint32_t migrants = 2;              //< Best chromosomes published by each migration
+        topologies topology = RING;
+    };
+
+    /**
+    @brief The content of a slot
+    */
+    struct Message
+    {
+        uint32_t dataset = 0;               //< The image of the training the island was on
+        uint32_t generation = 0;
+        uint32_t count = 0;                 //< Migrants
+        uint32_t finished = 0;              //< 1 once the island finished its training
+        float best_fitness = std::numeric_limits<float>::max();
+        std::array<float, genes> best {};   //< The best chromosome of the island on the image
+        std::array<float, max_migrants> fitness {};
+        std::array<float, max_migrants * genes> chromosomes {};
+    };
+
+    /**
+    @brief Counters since the model was created
+    */
+    struct Statistics
+    {
+        uint64_t published = 0;             //< Messages written
+        uint64_t received = 0;              //< Migrants placed in a generation
+        uint64_t rejected = 0;              //< Messages of an island on another image
+        uint64_t retries = 0;               //< Copies of a slot repeated because its writer was writing it
+    };
+
+private:
+
+    static constexpr uint32_t magic = 0x444C5349;  //< "ISLD"
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t islands;
+        uint64_t reserved;
+    };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;     //< Odd while the message is written
+        Message message;
+    };
+
+    Settings settings;
+    QSharedMemory memory;
+    Slot* slots = nullptr;
+
+    std::vector<uint32_t> last_sequences;   //< The sequence of each slot the last time its migrants were taken
+    std::vector<size_t> order;
+    Statistics statistics;
+
+public:
+
+    /**
+    @brief Creates an island that is not connected to the others yet
+    @param settings The islands, this island and the migration
+    */
+    explicit IslandModel(const Settings& settings);
+
+    /**
+    @brief Detaches from the mailbox
+    */
+    ~IslandModel();
+
+    IslandModel(const IslandModel&) = delete;
+    IslandModel& operator = (const IslandModel&) = delete;
+
+    /**
+    @brief Gets the topology of a name given in the command line
+    @param name ring or all
+    @param topology The topology of the name
+    @return True if the name is known
+    */
+    static bool parse_topology(const std::string& name, topologies& topology);
+
+    /**
+    @brief Creates the mailbox of the islands, before the other islands are launched
+    @param key The name of the shared memory, unique to the run
+    @return False if the shared memory can not be created
+    */
+    bool create(const std::string& key);
+
+    /**
+    @brief Attaches to the mailbox created by island 0
+    @param key The name of the shared memory
+    @return False if there is no mailbox for these settings
+    */
+    bool attach(const std::string& key);
+
+    /**
+    @brief Checks if the island is attached to a mailbox
+    @return True if the island can migrate
+    */
+    bool is_connected() const
+    {
+        return slots != nullptr;
+    }
+
+    /**
+    @brief Checks if the island publishes its best chromosomes after a generation
+    @param generation The generation, from 0
+    @return True every interval generations
+    */
+    bool is_due(uint32_t generation) const
+    {
+        return is_connected() && settings.interval > 0 && (generation + 1) % settings.interval == 0;
+    }
+
+    /**
+    @brief Publishes the best chromosomes of a generation and the best chromosome of the island
+    @param dataset The image the fitness was measured on
+    @param generation The generation
+    @param chromosomes The chromosomes of the generation, 6 weights per chromosome
+    @param fitness The fitness of each chromosome
+    @param best The best chromosome of the island
+    @param best_fitness Its fitness
+    @param finished True once the island finished its training
+    */
+    void emigrate(uint32_t dataset, uint32_t generation, const std::vector<float>& chromosomes, const std::vector<float>& fitness,
+                  const std::array<float, genes>& best, float best_fitness, bool finished = false);
+
+    /**
+    @brief Places the migrants published since the last call by the islands of the topology at the end of a batch,
+    in place of the chromosomes there. They are evaluated with the batch. Never more than half of the batch
+    @param dataset The image of the batch, the migrants of another image are dropped
+    @param chromosomes The batch, 6 weights per chromosome
+    @return The amount of migrants placed
+    */
+    size_t immigrate(uint32_t dataset, std::vector<float>& chromosomes);
+
+    /**
+    @brief Copies the message of an island
+    @param island The island
+    @param message The message
+    @return False if the island has not published yet or kept writing during every copy
+    */
+    bool read(uint32_t island, Message& message);
+
+    /**
+    @brief Gets the settings of the model
+    @return The settings
+    */
+    const Settings& get_settings() const
+    {
+        return settings;
+    }
+
+    /**
+    @brief Gets the counters since the model was created
+    @return The counters
+    */
+    const Statistics& get_statistics() const
+    {
+        return statistics;
+    }
+
+private:
+
+    /**
+    @brief Copies the message of an island and the sequence it was copied at
+    @param island The island
+    @param message The message
+    @param sequence The sequence of the slot, 0 if the island has not published yet
+    @return False if the island kept writing during every copy
+    */
+    bool read(uint32_t island, Message& message, uint32_t& sequence);
+
+    /**
+    @brief Gets the size of the shared memory of the islands
+    @return The size in bytes
+    */
+    size_t get_memory_size() const
+    {
+        return sizeof(Header) + settings.islands * sizeof(Slot);
+    }
+};
@@ -2,71 +2,165 @@
 
 #include <Neuron.hpp>
 #include <NNActivations.hpp>
+#include <NNRandom.hpp>
+#include <ThreadPool.hpp>
 #include <cstdint>
+#include <cstring>
+#include <memory_resource>
 
-/** 
- * Class that manages the data of a layer
+/**
+ * Class that manages the data of a layer.
+ * The values, deltas and weights of all the neurons are stored in flat aligned arrays owned by the layer,
+ * so the passes over a layer are linear streams over memory.
+ * The arrays come from a memory resource, so a whole population of networks can live in a single arena.
 */
 class Layer
 {
 
 private:
 
+    /**
+     * @brief The alignment in bytes of the layer arrays. Enough for a full cache line and any vector register.
+    */
+    static constexpr size_t alignment = 64;
+
+    typedef void (*activate_function) (float * values, size_t count);
+    typedef void (*derivate_function) (const float * values, float * derivates, size_t count);
+
+    std::pmr::memory_resource * resource;  //< Where the arrays are allocated
     NNActivations::activations activation;
-    Neuron ** neurons;
+    activate_function activate_kernel;     //< Instantiation for the activation of the layer, selected once
+    derivate_function derivate_kernel;     //< Instantiation for the derivate of the layer, selected once
     uint32_t neurons_count;
+    uint8_t weights_per_neuron;
+
+    float * values;     //< One value per neuron
+    float * deltas;     //< One delta per neuron
+    float * weights;    //< weights_per_neuron weights per neuron, stored neuron after neuron
 
 public:
 
-    /** 
+    /**
      * @brief Creates a layer of the given amount of neurons
      * @param neurons_count The amount of neurons of this layer
      * @param neurons_previous_layer The amount of neurons in the previous layer
      * @param activation The activation function type to apply to this layer
+     * @param resource The memory resource of the arrays. It must outlive the layer
     */
     Layer   (
                 uint32_t neurons_count,
                 uint32_t neurons_previous_layer,
-                NNActivations::activations activation = NNActivations::RELU
-            ) 
-            : 
-            neurons_count {neurons_count},
-            activation {activation}
+                NNActivations::activations activation = NNActivations::RELU,
+                std::pmr::memory_resource * resource = std::pmr::get_default_resource()
+            )
+            :
+            resource {resource},
+            activation {activation},
+            neurons_count {neurons_count}
     {
-        neurons = new Neuron * [neurons_count];
+        activate_kernel = NNActivations::dispatch(activation, [](auto policy) { return &activate_values<decltype(policy)>; });
+        derivate_kernel = NNActivations::dispatch(activation, [](auto policy) { return &derivate_values<decltype(policy)>; });
+
+        uint32_t weights_count = neurons_previous_layer / neurons_count;
+        weights_per_neuron = uint8_t (weights_count >= 1 ? weights_count : 1);
+
+        values  = allocate(neurons_count);
+        deltas  = allocate(neurons_count);
+        weights = allocate(size_t(neurons_count) * weights_per_neuron);
+
+        std::memset(values, 0, sizeof(float) * neurons_count);
+        std::memset(deltas, 0, sizeof(float) * neurons_count);
 
-        Neuron ** start = neurons;
-        Neuron ** end = start + neurons_count;
+        // Each layer has its own stream, so the chunks can be filled in parallel with the same values
+        const NNRandom generator(NNRandom::allocate_stream());
 
-        while (start < end)
+        ThreadPool::get().parallel_for(size_t(neurons_count) * weights_per_neuron, [&](size_t /*chunk*/, size_t begin, size_t end)
         {
-            uint8_t weights = neurons_previous_layer / neurons_count;
-            weights = weights >= 1 ? weights : 1;
-            (*start) = new Neuron(weights);
-            ++start;
-        }
+            generator.fill_at(weights + begin, end - begin, begin, -5.f, 5.f);
+        });
     }
 
-    /** 
+    Layer(const Layer&) = delete;
+    Layer& operator = (const Layer&) = delete;
+
+    /**
      * @brief Gets the activation function type of the layer
      * @return The activation type
     */
-    NNActivations::activations get_activation () 
+    NNActivations::activations get_activation ()
     {
         return activation;
     }
 
-    /** 
-     * @brief Gets the neurons of the layer
-     * @return The neurons of this layer
+    /**
+     * @brief Applies the activation of the layer to a collection of values
+     * @param values The first value. The activated values replace the given ones
+     * @param count The amount of values
+    */
+    void activate(float * values, size_t count)
+    {
+        activate_kernel(values, count);
+    }
+
+    /**
+     * @brief Calculates the derivate of the activation of the layer for a collection of activated values
+     * @param values The first activated value
+     * @param derivates The first derivate
+     * @param count The amount of values
     */
-    Neuron ** get_neurons()
+    void derivate(const float * values, float * derivates, size_t count)
     {
-        return neurons;
+        derivate_kernel(values, derivates, count);
     }
 
-    /** 
-     * @brief Gets the amount of neurons on this layer 
+    /**
+     * @brief Gets a view of the neuron at the given index. Kept for compatibility, prefer the flat arrays.
+     * @param index The index of the neuron
+     * @return The view of the neuron
+    */
+    Neuron get_neuron(uint32_t index)
+    {
+        return Neuron(values + index, deltas + index, weights + size_t(index) * weights_per_neuron, weights_per_neuron);
+    }
+
+    /**
+     * @brief Gets the values of the neurons of the layer
+     * @return The first value
+    */
+    float * get_values()
+    {
+        return values;
+    }
+
+    /**
+     * @brief Gets the deltas of the neurons of the layer
+     * @return The first delta
+    */
+    float * get_deltas()
+    {
+        return deltas;
+    }
+
+    /**
+     * @brief Gets the weights of the neurons of the layer. The weights of the neuron i start at i * get_weights_per_neuron()
+     * @return The first weight
+    */
+    float * get_weights()
+    {
+        return weights;
+    }
+
+    /**
+     * @brief Gets the amount of weights of each neuron of this layer
+     * @return The amount of weights of each neuron
+    */
+    uint8_t get_weights_per_neuron()
+    {
+        return weights_per_neuron;
+    }
+
+    /**
+     * @brief Gets the amount of neurons on this layer
      * @return The amount of neurons on this layer
     */
     uint32_t get_neurons_size()
@@ -77,14 +171,62 @@ public:
     /**
      * @brief Frees the memory
     */
-    ~Layer () 
+    ~Layer ()
+    {
+        deallocate(values, neurons_count);
+        deallocate(deltas, neurons_count);
+        deallocate(weights, size_t(neurons_count) * weights_per_neuron);
+    }
+
+private:
+
+    /**
+     * @brief Applies an activation to a collection of values
+     * @param values The first value. The activated values replace the given ones
+     * @param count The amount of values
+    */
+    template <class Activation>
+    static void activate_values(float * values, size_t count)
     {
-        for (uint32_t i = 0; i < neurons_count; ++i)
+        for (size_t i = 0; i < count; ++i)
         {
-            delete neurons[i];
+            values[i] = Activation::activate(values[i]);
         }
+    }
+
+    /**
+     * @brief Calculates the derivate of an activation for a collection of activated values
+     * @param values The first activated value
+     * @param derivates The first derivate
+     * @param count The amount of values
+    */
+    template <class Activation>
+    static void derivate_values(const float * values, float * derivates, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            derivates[i] = Activation::derivate(values[i]);
+        }
+    }
 
-        delete [] neurons;
+    /**
+     * @brief Allocates an aligned array of floats from the memory resource of the layer
+     * @param count The amount of floats
+     * @return The first float of the array
+    */
+    float * allocate(size_t count)
+    {
+        return static_cast<float *>(resource->allocate(sizeof(float) * (count > 0 ? count : 1), alignment));
+    }
+
+    /**
+     * @brief Returns an array of floats to the memory resource of the layer
+     * @param array The first float of the array
+     * @param count The amount of floats
+    */
+    void deallocate(float * array, size_t count)
+    {
+        resource->deallocate(array, sizeof(float) * (count > 0 ? count : 1), alignment);
     }
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <BinaryData.hpp>
+#include <ColorHistogram.hpp>
+#include <array>
+#include <cstdint>
+
+/**
+@brief Closed form fit of the LUV transform of the network. Without the activations the tied network is the
+3x3 matrix [wd, we, wf]^T [wa, wb, wc] applied to every pixel, so the training set can be streamed once to
+accumulate the normal equations of the least squares problem and the optimum solved directly.
+The optimum 3x3 matrix is reported with its error and factored into the best rank one matrix for the same data,
+which is the transform a BinaryData can hold. The ReLU network reproduces the factored transform on the pixels
+where the hidden value and the outputs are not negative.
+*/
+class LeastSquaresSolver
+{
+public:
+
+    typedef std::array<double, 9> Matrix;   //< Row major 3x3
+
+    struct Solution
+    {
+        Matrix transform;                   //< The optimum linear transform
+        double transform_error;             //< Mean squared error per pixel of the optimum
+        Matrix factored_transform;          //< The best transform of rank one
+        double factored_error;              //< Mean squared error per pixel of the rank one transform
+        BinaryData data;                    //< The rank one transform as tied weights
+    };
+
+private:
+
+    Matrix input_gram {};                   //< Sum of x x^T over the pixels
+    Matrix cross_gram {};                   //< Sum of t x^T over the pixels
+    std::array<double, 3> input_sum {};     //< Sum of x, to choose the sign of the factors
+    double desired_energy = 0.0;            //< Sum of |t|^2
+    double pixels = 0.0;
+
+public:
+
+    /**
+    @brief Adds the pixels of an image to the normal equations
+    @param histogram The colour table of the image
+    */
+    void accumulate(const ColorHistogram& histogram);
+
+    /**
+    @brief Solves the normal equations accumulated
+    @param first_layer_neurons The amount of input neurons of the network of the solution
+    @return The optimum, its rank one factorization and their errors
+    */
+    Solution solve(uint32_t first_layer_neurons) const;
+
+    /**
+    @brief Gets the mean squared error per pixel of a transform over the pixels accumulated, from the Gram matrices
+    @param transform The transform
+    @return The error
+    */
+    double get_error(const Matrix& transform) const;
+
+    /**
+    @brief Gets the amount of pixels accumulated
+    @return The amount of pixels
+    */
+    double get_pixels_count() const
+    {
+        return pixels;
+    }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <PopulationEvaluator.hpp>
+#include <ColorHistogram.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+@brief Local search step of the memetic training. Every few generations the best chromosomes of a generation get a
+few gradient steps over the colour table of the image, with Adam and the gradients of
+TiedNeuralNetwork::compute_gradients. The gradients are the ones of the squared error and the fitness is the sum of
+the delta colors, so a polished chromosome is scored again and only replaces the original when its fitness is lower.
+The optimizer then selects and recombines the polished chromosomes as any other.
+*/
+class MemeticRefiner
+{
+public:
+
+    static constexpr size_t genes = 6;
+
+    struct Settings
+    {
+        uint32_t interval = 0;              //< Generations between two refinements, 0 never refines
+        uint32_t steps = 10;                //< Gradient steps of each elite
+        uint32_t elites = 2;                //< Best chromosomes polished, never more than the optimizer selects
+        float learning_rate = 0.005f;       //< Adam moves each weight about this much per step
+    };
+
+    /**
+    @brief Counters since the refiner was created
+    */
+    struct Statistics
+    {
+        uint64_t refinements = 0;
+        uint64_t polished = 0;              //< Chromosomes polished
+        uint64_t improved = 0;              //< Polished chromosomes that replaced the original
+        uint64_t gradient_passes = 0;       //< Passes over a colour table, each one a feed forward and its gradients
+        double gain = 0.0;                  //< Sum of the relative fitness gain of the improved chromosomes
+    };
+
+private:
+
+    PopulationEvaluator& evaluator;
+    Settings settings;
+    Statistics statistics;
+
+    std::vector<size_t> order;
+    std::vector<float> polished;
+    std::vector<float> polished_fitness;
+
+public:
+
+    /**
+    @brief Creates a refiner
+    @param evaluator The evaluator that scores the polished chromosomes
+    @param settings The interval, steps and elites of the refinement
+    */
+    MemeticRefiner(PopulationEvaluator& evaluator, const Settings& settings) : evaluator{evaluator}, settings{settings}
+    {
+    }
+
+    /**
+    @brief Checks if the elites of a generation are refined
+    @param generation The generation, from 0
+    @return True every interval generations
+    */
+    bool is_due(uint32_t generation) const
+    {
+        return settings.interval > 0 && (generation + 1) % settings.interval == 0;
+    }
+
+    /**
+    @brief Polishes the best chromosomes of a generation and replaces the ones that improve
+    @param chromosomes The chromosomes of the generation, 6 weights per chromosome
+    @param fitness The fitness of each chromosome. The best ones must be complete
+    @param elites The amount of best chromosomes to polish, the amount the optimizer selects at most
+    @param histogram The colour table of the image the fitness is measured on
+    @return The amount of chromosomes replaced
+    */
+    size_t refine(std::vector<float>& chromosomes, std::vector<float>& fitness, size_t elites, const ColorHistogram& histogram);
+
+    /**
+    @brief Gets the settings of the refiner
+    @return The settings
+    */
+    const Settings& get_settings() const
+    {
+        return settings;
+    }
+
+    /**
+    @brief Gets the counters since the refiner was created
+    @return The counters
+    */
+    const Statistics& get_statistics() const
+    {
+        return statistics;
+    }
+};
@@ -10,10 +10,69 @@ class NNActivations
 
 public:
 
-    /** 
-     * @brief The different activation function types 
+    /**
+     * @brief The different activation function types
     */
-    enum activations {NONE, SIGMOID, TANH, RELU, LEAKYRELU};  
+    enum activations {NONE, SIGMOID, TANH, RELU, LEAKYRELU};
+
+    /**
+     * @brief Compile time policies of each activation type. The kernels are templated on them so the
+     * activation is inlined; the runtime type only selects the instantiation to use.
+     * The derivates receive the activated value, as the back propagation has it.
+    */
+    struct None
+    {
+        static float activate (float /*x*/) { return 0.0f; }
+        static float derivate (float /*x*/) { return 0.0f; }
+    };
+
+    struct Sigmoid
+    {
+        static float activate (float x)
+        {
+            float k = exp(x);
+            return k / (1.f + k);
+        }
+
+        static float derivate (float x) { return x * (1 - x); }
+    };
+
+    struct Tanh
+    {
+        static float activate (float x) { return tanhf(x); }
+        static float derivate (float x) { return 1 - x * x; }
+    };
+
+    struct Relu
+    {
+        static float activate (float x) { return 0 >= x ? 0.f : x; }
+        static float derivate (float x) { return 0 >= x ? 0.f : 1; }
+    };
+
+    struct LeakyRelu
+    {
+        static float activate (float x) { return 0 >= x ? 0.01f * x : x; }
+        static float derivate (float x) { return 0 >= x ? 0.01f : 1; }
+    };
+
+    /**
+     * @brief Calls the visitor with the policy of the given activation type
+     * @param activation The activation function type
+     * @param visitor A callable that receives a policy instance, for example a generic lambda
+     * @return The value returned by the visitor
+    */
+    template <class Visitor>
+    static auto dispatch (activations activation, Visitor&& visitor)
+    {
+        switch (activation)
+        {
+            case SIGMOID: return visitor(Sigmoid());
+            case TANH: return visitor(Tanh());
+            case RELU: return visitor(Relu());
+            case LEAKYRELU: return visitor(LeakyRelu());
+            default: return visitor(None());
+        }
+    }
 
 private:
 
@@ -21,8 +80,8 @@ private:
 
 public:
 
-    /** 
-     * @brief Gets a global accesible instance of this class. 
+    /**
+     * @brief Gets a global accesible instance of this class.
     */
     static NNActivations & get()
     {
@@ -30,47 +89,55 @@ public:
         return instance;
     }
 
+    /**
+     * @brief Calculate the activation value. Prefer the policies on hot loops
+     * @param value The value to use in the calculation
+     * @param activation The activation function type to apply
+     * @return The activated value
+    */
+    float activate (float value, activations activation)
+    {
+        return dispatch(activation, [value](auto policy) { return decltype(policy)::activate(value); });
+    }
+
     float sigmoid (float x)
     {
-        float k = exp(x);
-        return k / (1.f + k);
+        return Sigmoid::activate(x);
     }
 
     float tanh (float x)
     {
-        return tanhf(x);
+        return Tanh::activate(x);
     }
 
     float relu (float x)
     {
-        return 0 >= x ? 0.f : x;
+        return Relu::activate(x);
     }
 
     float leakyrelu (float x)
     {
-        return 0 >= x ? 0.01f * x : x;
+        return LeakyRelu::activate(x);
     }
 
     float sigmoid_derivate (float x)
     {
-        return x * (1 - x);
+        return Sigmoid::derivate(x);
     }
 
     float tanh_derivate (float x)
     {
-        return 1 - x * x;
+        return Tanh::derivate(x);
     }
 
     float relu_derivate (float x)
     {
-        return 0 >= x ? 0.f : 1;
+        return Relu::derivate(x);
     }
 
     float leakyrelu_derivate (float x)
     {
-        return 0 >= x ? 0.01f : 1;
+        return LeakyRelu::derivate(x);
     }
 
 };
-
-
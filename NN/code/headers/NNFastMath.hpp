@@ -0,0 +1,298 @@
+#pragma once
+
+#include <NNActivations.hpp>
+#include <Simd.hpp>
+#include <cstddef>
+#include <ostream>
+
+/**
+@brief Vectorized approximations of the activation functions and batch versions of them.
+
+The approximations are measured against the double precision libm result over [-80, 80]:
+    exp         (Cephes range reduction + degree 6 polynomial)   max 1.5 ulp on [-87.3, 88.3], clamped outside
+    sigmoid     (1 / (1 + exp(-|x|)) folded by sign)             max 3 ulp, max absolute error 1e-7
+    tanh        (odd polynomial for |x| < 0.625, exp otherwise)  max 1.5 ulp, max absolute error 1e-7
+    leakyrelu                                                   exact
+The SSE2 and AVX2 versions perform the same operations, so their results are the same bit for bit.
+check_accuracy measures them again against these bounds; the application runs it with --check-math and in
+benchmark option 7, next to the throughput of each mode.
+*/
+class NNFastMath
+{
+public:
+
+    /**
+    @brief PRECISE uses the scalar libm functions of NNActivations, FAST the vectorized approximations
+    */
+    enum modes {PRECISE, FAST};
+
+    /**
+    @brief Batch functions. The output can be the same collection as the input
+    @param input The first input value
+    @param output The first output value
+    @param count The amount of values
+    @param mode The precision mode
+    */
+    static void exp         (const float* input, float* output, size_t count, modes mode = FAST);
+    static void sigmoid     (const float* input, float* output, size_t count, modes mode = FAST);
+    static void tanh        (const float* input, float* output, size_t count, modes mode = FAST);
+    static void leakyrelu   (const float* input, float* output, size_t count, modes mode = FAST);
+
+    typedef void (*batch_function) (const float* input, float* output, size_t count, modes mode);
+
+    /**
+    @brief Error of the fast mode of a batch function against the double precision result
+    */
+    struct Accuracy
+    {
+        double max_ulp = 0.0;
+        double max_absolute = 0.0;
+    };
+
+    /**
+    @brief Measures the error of the fast mode of a batch function over evenly spaced values of a range
+    @param function The batch function
+    @param reference The double precision version of the function
+    @param minimum The minimum value of the range
+    @param maximum The maximum value of the range
+    @param count The amount of values
+    @return The largest errors
+    */
+    static Accuracy measure_accuracy(batch_function function, double (*reference)(double), float minimum, float maximum, size_t count = 1 << 20);
+
+    /**
+    @brief Measures every approximation and compares it with the bounds documented above, one line per function
+    ending with PASS or FAIL
+    @param stream Where the lines are written
+    @return True if every function is within its bounds
+    */
+    static bool check_accuracy(std::ostream& stream);
+
+    /**
+    @brief Fast policies, interchangeable with the NNActivations ones. The scalar functions run the vector code on a
+    single lane so every path of a kernel gives the same values.
+    */
+    struct Sigmoid
+    {
+        static float activate (float x) { return _mm_cvtss_f32(sigmoid_sse2(_mm_set_ss(x))); }
+        static float derivate (float x) { return NNActivations::Sigmoid::derivate(x); }
+        static __m128 sse2 (__m128 x) { return sigmoid_sse2(x); }
+        NN_TARGET_AVX2 static __m256 avx2 (__m256 x) { return sigmoid_avx2(x); }
+    };
+
+    struct Tanh
+    {
+        static float activate (float x) { return _mm_cvtss_f32(tanh_sse2(_mm_set_ss(x))); }
+        static float derivate (float x) { return NNActivations::Tanh::derivate(x); }
+        static __m128 sse2 (__m128 x) { return tanh_sse2(x); }
+        NN_TARGET_AVX2 static __m256 avx2 (__m256 x) { return tanh_avx2(x); }
+    };
+
+    /**
+    @brief Calls the visitor with the policy of the given activation type for the given mode.
+    In FAST mode sigmoid and tanh use the approximations, the rest are already exact and vectorized.
+    @param activation The activation function type
+    @param mode The precision mode
+    @param visitor A callable that receives a policy instance, for example a generic lambda
+    @return The value returned by the visitor
+    */
+    template <class Visitor>
+    static auto dispatch (NNActivations::activations activation, modes mode, Visitor&& visitor)
+    {
+        if (mode == FAST && activation == NNActivations::SIGMOID)
+        {
+            return visitor(Sigmoid());
+        }
+
+        if (mode == FAST && activation == NNActivations::TANH)
+        {
+            return visitor(Tanh());
+        }
+
+        return NNActivations::dispatch(activation, visitor);
+    }
+
+    /**
+    @brief Approximation of exp for 4 values
+    @param x The values
+    @return The approximated values
+    */
+    static __m128 exp_sse2 (__m128 x)
+    {
+        x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.33654f)), _mm_set1_ps(88.37626f));
+
+        // n = round(x / ln 2), done with truncation and correction as SSE2 has no round
+        __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+        __m128i n = _mm_cvttps_epi32(fx);
+        __m128 t = _mm_cvtepi32_ps(n);
+        __m128 correction = _mm_and_ps(_mm_cmpgt_ps(t, fx), _mm_set1_ps(1.f));
+        t = _mm_sub_ps(t, correction);
+        n = _mm_cvttps_epi32(t);
+
+        // r = x - n * ln 2 in two steps to keep the precision
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(t, _mm_set1_ps(0.693359375f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(t, _mm_set1_ps(-2.12194440e-4f)));
+
+        __m128 p = _mm_set1_ps(1.9875691500E-4f);
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.3981999507E-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073E-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894E-2f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459E-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201E-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), _mm_add_ps(r, _mm_set1_ps(1.f)));
+
+        // p * 2^n building the exponent bits
+        __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+        return _mm_mul_ps(p, pow2n);
+    }
+
+    /**
+    @brief Approximation of exp for 8 values
+    @param x The values
+    @return The approximated values
+    */
+    NN_TARGET_AVX2 static __m256 exp_avx2 (__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.33654f)), _mm256_set1_ps(88.37626f));
+
+        __m256 fx = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)), _mm256_set1_ps(0.5f));
+        __m256i n = _mm256_cvttps_epi32(fx);
+        __m256 t = _mm256_cvtepi32_ps(n);
+        __m256 correction = _mm256_and_ps(_mm256_cmp_ps(t, fx, _CMP_GT_OQ), _mm256_set1_ps(1.f));
+        t = _mm256_sub_ps(t, correction);
+        n = _mm256_cvttps_epi32(t);
+
+        __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(t, _mm256_set1_ps(0.693359375f)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(t, _mm256_set1_ps(-2.12194440e-4f)));
+
+        __m256 p = _mm256_set1_ps(1.9875691500E-4f);
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(1.3981999507E-3f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(8.3334519073E-3f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(4.1665795894E-2f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(1.6666665459E-1f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(5.0000001201E-1f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, _mm256_mul_ps(r, r)), _mm256_add_ps(r, _mm256_set1_ps(1.f)));
+
+        __m256 pow2n = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23));
+        return _mm256_mul_ps(p, pow2n);
+    }
+
+    /**
+    @brief Approximation of sigmoid for 4 values
+    @param x The values
+    @return The approximated values
+    */
+    static __m128 sigmoid_sse2 (__m128 x)
+    {
+        const __m128 sign_mask = _mm_set1_ps(-0.f);
+        const __m128 one = _mm_set1_ps(1.f);
+
+        // e = exp(-|x|) never overflows. sigmoid(x) = 1 / (1 + e) for x >= 0 and e / (1 + e) for x < 0
+        __m128 e = exp_sse2(_mm_or_ps(x, sign_mask));
+        __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+        __m128 numerator = _mm_or_ps(_mm_and_ps(negative, e), _mm_andnot_ps(negative, one));
+
+        return _mm_div_ps(numerator, _mm_add_ps(one, e));
+    }
+
+    /**
+    @brief Approximation of sigmoid for 8 values
+    @param x The values
+    @return The approximated values
+    */
+    NN_TARGET_AVX2 static __m256 sigmoid_avx2 (__m256 x)
+    {
+        const __m256 sign_mask = _mm256_set1_ps(-0.f);
+        const __m256 one = _mm256_set1_ps(1.f);
+
+        __m256 e = exp_avx2(_mm256_or_ps(x, sign_mask));
+        __m256 negative = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ);
+        __m256 numerator = _mm256_blendv_ps(one, e, negative);
+
+        return _mm256_div_ps(numerator, _mm256_add_ps(one, e));
+    }
+
+    /**
+    @brief Approximation of tanh for 4 values
+    @param x The values
+    @return The approximated values
+    */
+    static __m128 tanh_sse2 (__m128 x)
+    {
+        const __m128 sign_mask = _mm_set1_ps(-0.f);
+        const __m128 one = _mm_set1_ps(1.f);
+
+        __m128 sign = _mm_and_ps(x, sign_mask);
+        __m128 absolute = _mm_andnot_ps(sign_mask, x);
+
+        // Small values: x + x^3 * P(x^2), avoids the cancellation of the exp form
+        __m128 z = _mm_mul_ps(x, x);
+        __m128 p = _mm_set1_ps(-5.70498872745E-3f);
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(2.06390887954E-2f));
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-5.37397155531E-2f));
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.33314422036E-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(-3.33332819422E-1f));
+        __m128 small = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), x), x);
+
+        // Big values: 1 - 2 / (exp(2|x|) + 1) with the sign of x. Over 9 the result rounds to 1, the clamp
+        // keeps the division away from subnormals
+        __m128 clamped = _mm_min_ps(absolute, _mm_set1_ps(9.f));
+        __m128 e = exp_sse2(_mm_add_ps(clamped, clamped));
+        __m128 big = _mm_sub_ps(one, _mm_div_ps(_mm_set1_ps(2.f), _mm_add_ps(e, one)));
+        big = _mm_or_ps(big, sign);
+
+        __m128 is_small = _mm_cmplt_ps(absolute, _mm_set1_ps(0.625f));
+        return _mm_or_ps(_mm_and_ps(is_small, small), _mm_andnot_ps(is_small, big));
+    }
+
+    /**
+    @brief Approximation of tanh for 8 values
+    @param x The values
+    @return The approximated values
+    */
+    NN_TARGET_AVX2 static __m256 tanh_avx2 (__m256 x)
+    {
+        const __m256 sign_mask = _mm256_set1_ps(-0.f);
+        const __m256 one = _mm256_set1_ps(1.f);
+
+        __m256 sign = _mm256_and_ps(x, sign_mask);
+        __m256 absolute = _mm256_andnot_ps(sign_mask, x);
+
+        __m256 z = _mm256_mul_ps(x, x);
+        __m256 p = _mm256_set1_ps(-5.70498872745E-3f);
+        p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(2.06390887954E-2f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(-5.37397155531E-2f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(1.33314422036E-1f));
+        p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(-3.33332819422E-1f));
+        __m256 small = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, z), x), x);
+
+        __m256 clamped = _mm256_min_ps(absolute, _mm256_set1_ps(9.f));
+        __m256 e = exp_avx2(_mm256_add_ps(clamped, clamped));
+        __m256 big = _mm256_sub_ps(one, _mm256_div_ps(_mm256_set1_ps(2.f), _mm256_add_ps(e, one)));
+        big = _mm256_or_ps(big, sign);
+
+        return _mm256_blendv_ps(big, small, _mm256_cmp_ps(absolute, _mm256_set1_ps(0.625f), _CMP_LT_OQ));
+    }
+
+    /**
+    @brief Leaky relu for 4 values. Same results as NNActivations::LeakyRelu
+    @param x The values
+    @return The activated values
+    */
+    static __m128 leakyrelu_sse2 (__m128 x)
+    {
+        __m128 mask = _mm_cmple_ps(x, _mm_setzero_ps());
+        return _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(_mm_set1_ps(0.01f), x)), _mm_andnot_ps(mask, x));
+    }
+
+    /**
+    @brief Leaky relu for 8 values. Same results as NNActivations::LeakyRelu
+    @param x The values
+    @return The activated values
+    */
+    NN_TARGET_AVX2 static __m256 leakyrelu_avx2 (__m256 x)
+    {
+        __m256 mask = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LE_OQ);
+        return _mm256_blendv_ps(x, _mm256_mul_ps(_mm256_set1_ps(0.01f), x), mask);
+    }
+};
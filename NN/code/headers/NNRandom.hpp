@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+@brief Counter based random numbers (Philox4x32-10) derived from a single seed per run.
+The value at a position of a stream is a pure function of (run seed, stream, position), so the streams can be
+filled in parallel by chunks and give the same values with any amount of threads. Identical seeds replay a run.
+*/
+class NNRandom
+{
+private:
+
+    uint64_t seed;                  //< The run seed when the generator was created
+    uint64_t stream;
+    uint64_t position = 0;          //< Index of the next value in the stream
+
+    std::array<uint32_t, 4> block;  //< The last generated block of 4 values
+    uint64_t block_index = ~uint64_t(0);
+
+public:
+
+    /**
+    @brief Creates a generator over a stream of the run seed
+    @param stream The stream, for example a network or layer index or allocate_stream()
+    */
+    explicit NNRandom(uint64_t stream) : seed{get_seed()}, stream{stream}
+    {
+    }
+
+    /**
+    @brief Sets the seed of the run and restarts the streams. The generators already created keep the previous seed
+    @param seed The seed
+    */
+    static void set_seed(uint64_t seed);
+
+    /**
+    @brief Gets the seed of the run
+    @return The seed
+    */
+    static uint64_t get_seed();
+
+    /**
+    @brief Generates a seed from the system entropy, meant to be logged and passed back to replay a run
+    @return The new seed
+    */
+    static uint64_t generate_seed();
+
+    /**
+    @brief Gets a new stream index. The indexes are given in order, so the code that creates the streams in the same
+    order gets the same streams
+    @return The stream index
+    */
+    static uint64_t allocate_stream();
+
+    /**
+    @brief Gets the generator of the calling thread. The main thread uses stream 0; the other threads get a stream
+    in the order they first call this function, prefer explicit streams for parallel code that must be replayable
+    @return The generator of the thread
+    */
+    static NNRandom& get();
+
+    /**
+    @brief Gets the seed the generator was created with
+    @return The seed
+    */
+    uint64_t get_generator_seed() const
+    {
+        return seed;
+    }
+
+    /**
+    @brief Gets the position of the generator in its stream, with the seed and the stream all its state
+    @return The index of the next value
+    */
+    uint64_t get_position() const
+    {
+        return position;
+    }
+
+    /**
+    @brief Moves the generator to a position of its stream, for example the one of a checkpoint
+    @param value The index of the next value
+    */
+    void set_position(uint64_t value)
+    {
+        position = value;
+    }
+
+    /**
+    @brief Gets the next value of the stream
+    @return A uniformly distributed 32 bit value
+    */
+    uint32_t next()
+    {
+        uint64_t index = position >> 2;
+
+        if (index != block_index)
+        {
+            block = philox(seed, stream, index);
+            block_index = index;
+        }
+
+        return block[position++ & 3];
+    }
+
+    /**
+    @brief Gets the next value of the stream in [0, 1)
+    @return The value
+    */
+    float next_float()
+    {
+        return to_float(next());
+    }
+
+    /**
+    @brief Gets the next value of the stream in [minimum, maximum)
+    @param minimum The minimum value
+    @param maximum The maximum value
+    @return The value
+    */
+    float next_float(float minimum, float maximum)
+    {
+        return to_float(next()) * (maximum - minimum) + minimum;
+    }
+
+    /**
+    @brief Gets a normally distributed value from the next two values of the stream, with Box-Muller
+    @return The value, with mean 0 and standard deviation 1
+    */
+    float next_gaussian()
+    {
+        const double radius = std::sqrt(-2.0 * std::log(1.0 - double(next_float())));
+        const double angle = 6.283185307179586 * next_float();
+
+        return float(radius * std::cos(angle));
+    }
+
+    /**
+    @brief Fills a collection with the next values of the stream in [minimum, maximum)
+    @param values The first value
+    @param count The amount of values
+    @param minimum The minimum value
+    @param maximum The maximum value
+    */
+    void fill(float* values, size_t count, float minimum, float maximum)
+    {
+        fill_at(values, count, position, minimum, maximum);
+        position += count;
+    }
+
+    /**
+    @brief Fills a collection with the values of the stream at the given positions in [minimum, maximum), without
+    advancing the generator. Meant to fill the chunks of a collection in parallel
+    @param values The first value
+    @param count The amount of values
+    @param first The position of the stream of the first value
+    @param minimum The minimum value
+    @param maximum The maximum value
+    */
+    void fill_at(float* values, size_t count, uint64_t first, float minimum, float maximum) const
+    {
+        const float range = maximum - minimum;
+
+        size_t i = 0;
+
+        while (i < count)
+        {
+            const uint64_t position = first + i;
+            const std::array<uint32_t, 4> values_block = philox(seed, stream, position >> 2);
+
+            for (uint64_t lane = position & 3; lane < 4 && i < count; ++lane, ++i)
+            {
+                values[i] = to_float(values_block[lane]) * range + minimum;
+            }
+        }
+    }
+
+    /**
+    @brief Philox4x32-10 block function
+    @param key The run seed
+    @param stream The high half of the counter
+    @param index The low half of the counter
+    @return 4 uniformly distributed 32 bit values
+    */
+    static std::array<uint32_t, 4> philox(uint64_t key, uint64_t stream, uint64_t index)
+    {
+        uint32_t counter[4] = {uint32_t(index), uint32_t(index >> 32), uint32_t(stream), uint32_t(stream >> 32)};
+        uint32_t keys[2] = {uint32_t(key), uint32_t(key >> 32)};
+
+        for (int round = 0; round < 10; ++round)
+        {
+            const uint64_t product_0 = uint64_t(0xD2511F53u) * counter[0];
+            const uint64_t product_1 = uint64_t(0xCD9E8D57u) * counter[2];
+
+            const uint32_t next[4] =    {
+                                            uint32_t(product_1 >> 32) ^ counter[1] ^ keys[0],
+                                            uint32_t(product_1),
+                                            uint32_t(product_0 >> 32) ^ counter[3] ^ keys[1],
+                                            uint32_t(product_0)
+                                        };
+
+            counter[0] = next[0];
+            counter[1] = next[1];
+            counter[2] = next[2];
+            counter[3] = next[3];
+
+            keys[0] += 0x9E3779B9u;
+            keys[1] += 0xBB67AE85u;
+        }
+
+        return {counter[0], counter[1], counter[2], counter[3]};
+    }
+
+private:
+
+    /**
+    @brief Converts a 32 bit value to a float in [0, 1) with the 24 bits of precision of the float
+    @param value The value
+    @return The float
+    */
+    static float to_float(uint32_t value)
+    {
+        return float(value >> 8) * (1.f / 16777216.f);
+    }
+};
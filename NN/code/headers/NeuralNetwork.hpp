@@ -1,63 +1,27 @@
 #pragma once
 
 #include <Layer.hpp>
+#include <BinaryData.hpp>
+#include <PixelKernel.hpp>
+#include <ThreadPool.hpp>
 #include <fstream>
 #include <iostream>
+#include <memory_resource>
+#include <new>
 #include <string>
 #include <vector>
 #include <sstream>
 
-struct BinaryData
-{
-    float wa;
-    float wb;
-    float wc;
-    float wd;
-    float we;
-    float wf;
-
-    uint32_t first_layer_neurons;
-
-    std::string to_string()
-    {
-        return  std::to_string(wa) + "&" +
-                std::to_string(wb) + "&" +
-                std::to_string(wc) + "&" +
-                std::to_string(wd) + "&" +
-                std::to_string(we) + "&" +
-                std::to_string(wf) + "&" +
-                std::to_string(first_layer_neurons);
-                            
-    }
-
-    void read(std::string s)
-    {
-        std::stringstream test(s);
-        std::string segment;
-        std::vector<std::string> collection;
-
-        while (std::getline(test, segment, '&'))
-        {
-            collection.push_back(segment);
-        }
-
-        wa = std::stof(collection[0]);
-        wb = std::stof(collection[1]);
-        wc = std::stof(collection[2]);
-        wd = std::stof(collection[3]);
-        we = std::stof(collection[4]);
-        wf = std::stof(collection[5]);
-        first_layer_neurons = std::stoul(collection[6]);        
-    }
-};
-
 class NeuralNetwork
 {
 private:
 
+    std::pmr::memory_resource* resource;    //< Where the layers and their arrays are allocated
     Layer** layers;
     uint32_t layers_count;
     float learning_rate = 0.01f;
+
+    bool tied = false;      //< True when every hidden neuron and every output triplet share the same weights
        
 
 public:
@@ -66,10 +30,18 @@ public:
     @brief Creates a neural network with the proposed structure
     @param first_layer_neurons The amount of neurons in the input layer
     @param layers_count The amount of layers. By default it's value is 3
+    @param resource The memory resource of the layers, for example the arena of a population. It must outlive the network
     */
-    NeuralNetwork( uint32_t first_layer_neurons, uint32_t layers_count = 3 ) : layers_count{layers_count}
+    NeuralNetwork   (
+                        uint32_t first_layer_neurons,
+                        uint32_t layers_count = 3,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource()
+                    )
+                    :
+                    resource {resource},
+                    layers_count {layers_count}
     {
-        this->layers = new Layer * [layers_count];
+        this->layers = static_cast<Layer**>(resource->allocate(sizeof(Layer*) * layers_count, alignof(Layer*)));
         
         // The proposed method only has 3 layers connected in a particular way
         // The first or input layer
@@ -83,8 +55,9 @@ public:
     /**
     @brief Creates a neural network with the data of a binary file
     @param path The path of the file with the data
+    @param resource The memory resource of the layers. It must outlive the network
     */
-    NeuralNetwork(std::string path);
+    NeuralNetwork(std::string path, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     /**
     @brief Export the neural network data to a binary file
@@ -93,7 +66,7 @@ public:
     void export_network(std::string path);
     
     /**
-    @brief Get the layers of the network
+    @brief Get the layers of the network. Editing the weights directly must be followed by apply_binary_data
     @return The layers
     */
     Layer** get_layers()
@@ -115,12 +88,12 @@ public:
     {
         BinaryData data;
 
-        data.wa = layers[1]->get_neurons()[0]->get_weights()[0];
-        data.wb = layers[1]->get_neurons()[0]->get_weights()[1];
-        data.wc = layers[1]->get_neurons()[0]->get_weights()[2];
-        data.wd = layers[2]->get_neurons()[0]->get_weights()[0];
-        data.we = layers[2]->get_neurons()[1]->get_weights()[0];
-        data.wf = layers[2]->get_neurons()[2]->get_weights()[0];        
+        data.wa = layers[1]->get_weights()[0];
+        data.wb = layers[1]->get_weights()[1];
+        data.wc = layers[1]->get_weights()[2];
+        data.wd = layers[2]->get_weights()[0];
+        data.we = layers[2]->get_weights()[1];
+        data.wf = layers[2]->get_weights()[2];
 
         data.first_layer_neurons = layers[0]->get_neurons_size();
 
@@ -128,33 +101,67 @@ public:
     }
 
 
+    NeuralNetwork(const NeuralNetwork&) = delete;
+    NeuralNetwork& operator = (const NeuralNetwork&) = delete;
+
     /**
-    @brief Releases the dynamic memory
+    @brief Releases the dynamic memory. With an arena resource the memory is only released with the arena
     */
     ~NeuralNetwork()
     {
         for (uint32_t i = 0; i < layers_count; ++i)
         {
-            delete layers[i];
+            layers[i]->~Layer();
+            resource->deallocate(layers[i], sizeof(Layer), alignof(Layer));
         }
 
-        delete[] layers;
+        resource->deallocate(layers, sizeof(Layer*) * layers_count, alignof(Layer*));
     }
     
 
     /**
     @brief Calculates the value of each neuron by the feed_forward process. The output is stored in the given parameter.
+    When the weights are tied the network runs as a per pixel kernel, that keeps the hidden layer values only.
     @param inputs A pointer to the first input
     @param output A pointer to the first output
     */
     void feed_forward(std::vector<float>& inputs, std::vector<float>& output);
 
     /**
-    @brief Calculates the backpropagation
-    @param output The output values of the information proccess of the feed_forward output
+    @brief Calculates the value of each neuron walking all the layers of the network. The output is stored in the given parameter.
+    @param inputs A pointer to the first input
+    @param output A pointer to the first output
+    */
+    void feed_forward_graph(std::vector<float>& inputs, std::vector<float>& output);
+
+    /**
+    @brief Compiles the network into its per pixel kernel. Only valid when the weights are tied
+    @return The kernel of the network
+    */
+    PixelKernel compile()
+    {
+        return PixelKernel(get_binary_data(), layers[1]->get_activation(), layers[2]->get_activation());
+    }
+
+    /**
+    @brief Checks if the network shares the weights as the proposed method. Set by apply_binary_data and back_propagation
+    @return True if the weights are tied
+    */
+    bool is_tied()
+    {
+        return tied;
+    }
+
+    /**
+    @brief Calculates the backpropagation: a gradient descent step of the tied weights with the mean of the
+    gradients of every neuron, the same step as TiedNeuralNetwork::back_propagation. The deltas go through the
+    derivates of the activations of each layer. An untied network is tied from the weights of its first neurons.
+    The sums of the gradients are the same with any amount of threads
+    @param inputs The input values of the feed_forward process
+    @param output The output values of the feed_forward process
     @param desired The desired values
     */
-    void back_propagation(std::vector<float>& output, std::vector<float>& desired);
+    void back_propagation(const std::vector<float>& inputs, const std::vector<float>& output, const std::vector<float>& desired);
 
     /**
     @brief Training with genetic algorithim
@@ -172,28 +179,11 @@ private:
     */
     void initialize_layer(uint32_t index, uint32_t neurons_count, uint32_t previous_layer_neurons_count)
     {
-        layers[index] = index > 0 ? 
-                                    new Layer (neurons_count, layers[index-1]->get_neurons_size()) :
-                                    new Layer (neurons_count, 0);
-    }
+        void* memory = resource->allocate(sizeof(Layer), alignof(Layer));
 
-    /**
-    @brief Calculate the activation value 
-    @param value The value to use in the calculation
-    @param activation The activation function type to apply
-    @return The activated value
-    */
-    float activate(float value, NNActivations::activations activation)
-    {
-        switch (activation)
-        {
-            case NNActivations::SIGMOID: return NNActivations::get().sigmoid(value);
-            case NNActivations::TANH: return NNActivations::get().tanh(value);
-            case NNActivations::RELU: return NNActivations::get().relu(value);
-            case NNActivations::LEAKYRELU: return NNActivations::get().leakyrelu(value);
-            default: return 0.0f;
-        }
+        layers[index] = index > 0 ? 
+                                    new (memory) Layer (neurons_count, layers[index-1]->get_neurons_size(), NNActivations::RELU, resource) :
+                                    new (memory) Layer (neurons_count, 0, NNActivations::RELU, resource);
     }
 
-};
-
+};
\ No newline at end of file
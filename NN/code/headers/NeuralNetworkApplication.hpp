@@ -2,10 +2,28 @@
 
 
 #include <qguiapplication.h>
+#include <qprocess.h>
 #include <Image.hpp>
 #include <NeuralNetwork.hpp>
+#include <TiedNeuralNetwork.hpp>
+#include <GradientTrainer.hpp>
+#include <PopulationEvaluator.hpp>
+#include <ProgressiveEvaluator.hpp>
+#include <ColorHistogram.hpp>
+#include <LeastSquaresSolver.hpp>
+#include <Optimizer.hpp>
+#include <MemeticRefiner.hpp>
+#include <SurrogateModel.hpp>
+#include <FitnessCache.hpp>
+#include <Checkpoint.hpp>
+#include <IslandModel.hpp>
+#include <ConvergenceMonitor.hpp>
+#include <DatasetCache.hpp>
+#include <NNFastMath.hpp>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <algorithm>
 
 #include <chrono>
 #include <ctime>
@@ -23,6 +41,33 @@ private:
     bool exporting = false;
     std::string export_path;
 
+    uint32_t population_size = 64;          //< Networks of the genetic training. Set with --population <size>
+    uint32_t genetic_generations = 300;     //< Generations per image of the genetic training. Set with --generations <count>
+
+    Optimizer::strategies optimizer_strategy = Optimizer::GENETIC;    //< Set with --optimizer genetic|cmaes|de
+    uint32_t memetic_interval = 0;          //< Generations between the gradient polishing of the elites, 0 for none. Set with --memetic <generations>
+    float surrogate_fraction = 0.f;         //< Share of the new chromosomes evaluated after the surrogate ranks them, 0 for none. Set with --surrogate <fraction>
+    uint32_t batch_images = 0;              //< Images of the whole training set scored by each generation, 0 to train image by image. Set with --batch <images>
+    uint32_t checkpoint_interval = 0;       //< Generations between two checkpoints of the genetic training, 0 for none. Set with --checkpoint <generations>
+    bool resume = false;                    //< Continue the genetic training from its checkpoint. Set with --resume
+
+    uint32_t islands = 1;                   //< Processes of the genetic training, each with its own population. Set with --islands <count>
+    uint32_t migration_interval = 10;       //< Generations between two migrations of the islands, 0 for none. Set with --migration <generations>
+    uint32_t migrants = 2;                  //< Best chromosomes each island sends by migration. Set with --migrants <count>
+    IslandModel::topologies island_topology = IslandModel::RING;     //< Set with --topology ring|all
+
+    uint32_t island = 0;                    //< The island of this process. Island 0 launches the others with --island <index>
+    uint32_t island_task = 0;               //< The menu option a launched island runs, set with --task <option>
+    std::string island_mailbox;             //< The shared memory of the islands, set with --mailbox <key>
+    std::vector<std::string> arguments;     //< The command line, passed on to the launched islands
+
+    uint32_t convergence_patience = 0;      //< Stalled generations or updates in a row that end a training run early, 0 for none. Set with --patience <steps>
+    uint32_t convergence_window = 20;       //< Generations or updates averaged to measure the improvement. Set with --window <steps>
+    float minimum_improvement = 0.001f;     //< Relative improvement over a window below which a step is stalled. Set with --min-improvement <fraction>
+
+    bool use_dataset_cache = true;          //< Read the training set from its compiled file instead of the PNG files. Disabled with --no-dataset-cache
+    DatasetCache dataset_cache;
+
 public:
 
     /**
@@ -30,6 +75,8 @@ public:
     */
     NeuralNetworkApplication(int& argc, char** argv) : QGuiApplication(argc, argv)
     {
+        read_arguments(argc, argv);
+
         std::cout << std::endl << std::endl;
 
         std::cout << 
@@ -58,10 +105,22 @@ public:
         std::cout << "4: Transform an image using Deuteranopia training"      << std::endl;
         std::cout << "5: Transform an image using Protanopia training"      << std::endl;
         std::cout << "6: Transform an image using Tritanopia training"      << std::endl;
+        std::cout << "7: Benchmark the network passes"      << std::endl;
+        std::cout << "8: Gradient train the network for Deuteranopia"      << std::endl;
+        std::cout << "9: Gradient train the network for Protanopia"      << std::endl;
+        std::cout << "10: Gradient train the network for Tritanopia"      << std::endl;
+        std::cout << "11: Solve the network in closed form for Deuteranopia"      << std::endl;
+        std::cout << "12: Solve the network in closed form for Protanopia"      << std::endl;
+        std::cout << "13: Solve the network in closed form for Tritanopia"      << std::endl;
+        std::cout << "14: Compare the optimizers for Deuteranopia"      << std::endl;
         
-        int input;
-        
-        std::cin >> input;
+        int input = int(island_task);
+
+        // The islands launched by island 0 run the training it runs
+        if (island == 0)
+        {
+            std::cin >> input;
+        }
 
         system("cls");
         
@@ -156,6 +215,100 @@ public:
             transform(name, "../../assets/data/data_TRITANOPIA_LMS.dat");
 
             break;            
+        case 7:
+            benchmark(500, 500);
+
+            break;
+        case 8:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::DEUTERANOPIA;
+            training(500, 500, "../../assets/data/data_DEUTERANOPIA_LMS.dat");
+
+            end = std::chrono::system_clock::now();
+
+            elapsed_minutes = (end - start) / 60;
+            end_time = std::chrono::system_clock::to_time_t(end);
+
+            std::cout << std::endl << "Finished at " << std::ctime(&end_time) << std::endl
+                << "Elapsed time: " << elapsed_minutes.count() << "minutes";
+
+            break;
+        case 9:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::PROTANOPIA;
+            training(500, 500, "../../assets/data/data_PROTANOPIA_LMS.dat");
+
+            end = std::chrono::system_clock::now();
+
+            elapsed_minutes = (end - start) / 60;
+            end_time = std::chrono::system_clock::to_time_t(end);
+
+            std::cout << std::endl << "Finished at " << std::ctime(&end_time) << std::endl
+                << "Elapsed time: " << elapsed_minutes.count() << "minutes";
+
+            break;
+        case 10:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::TRITANOPIA;
+            training(500, 500, "../../assets/data/data_TRITANOPIA_LMS.dat");
+
+            end = std::chrono::system_clock::now();
+
+            elapsed_minutes = (end - start) / 60;
+            end_time = std::chrono::system_clock::to_time_t(end);
+
+            std::cout << std::endl << "Finished at " << std::ctime(&end_time) << std::endl
+                << "Elapsed time: " << elapsed_minutes.count() << "minutes";
+
+            break;
+        case 11:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::DEUTERANOPIA;
+            least_squares(500, 500, "../../assets/data/data_DEUTERANOPIA_LMS.dat");
+
+            end = std::chrono::system_clock::now();
+
+            elapsed_minutes = (end - start) / 60;
+            end_time = std::chrono::system_clock::to_time_t(end);
+
+            std::cout << std::endl << "Finished at " << std::ctime(&end_time) << std::endl
+                << "Elapsed time: " << elapsed_minutes.count() << "minutes";
+
+            break;
+        case 12:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::PROTANOPIA;
+            least_squares(500, 500, "../../assets/data/data_PROTANOPIA_LMS.dat");
+
+            end = std::chrono::system_clock::now();
+
+            elapsed_minutes = (end - start) / 60;
+            end_time = std::chrono::system_clock::to_time_t(end);
+
+            std::cout << std::endl << "Finished at " << std::ctime(&end_time) << std::endl
+                << "Elapsed time: " << elapsed_minutes.count() << "minutes";
+
+            break;
+        case 13:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::TRITANOPIA;
+            least_squares(500, 500, "../../assets/data/data_TRITANOPIA_LMS.dat");
+
+            end = std::chrono::system_clock::now();
+
+            elapsed_minutes = (end - start) / 60;
+            end_time = std::chrono::system_clock::to_time_t(end);
+
+            std::cout << std::endl << "Finished at " << std::ctime(&end_time) << std::endl
+                << "Elapsed time: " << elapsed_minutes.count() << "minutes";
+
+            break;
+        case 14:
+            evaluation = evaluation_type::LMS;
+            type = impairment_types::DEUTERANOPIA;
+            compare_optimizers(500, 500);
+
+            break;
         }
 
         std::cout << std::endl << "Done! :)";       
@@ -163,17 +316,205 @@ public:
     }
 
     /**
-    @brief Train the neural network with images of the given size
+    @brief Reads the settings given in the command line: --population <size>, --generations <count>,
+    --optimizer genetic|cmaes|de, --memetic <generations>, --surrogate <fraction>, --batch <images>,
+    --checkpoint <generations>, --resume, --islands <count>, --migration <generations>, --migrants <count> and
+    --topology ring|all, --patience <steps>, --window <steps>, --min-improvement <fraction> and --no-dataset-cache
+    @param argc The amount of arguments
+    @param argv The arguments
+    */
+    void read_arguments(int argc, char** argv)
+    {
+        arguments.assign(argv + 1, argv + argc);
+
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+
+            // The settings without a value
+            if (argument == "--resume")
+            {
+                resume = true;
+                continue;
+            }
+
+            if (argument == "--no-dataset-cache")
+            {
+                use_dataset_cache = false;
+                continue;
+            }
+
+            if (i + 1 == argc)
+            {
+                break;
+            }
+
+            if (argument == "--population")
+            {
+                population_size = std::max(2ul, std::stoul(argv[i + 1]));
+            }
+            else if (argument == "--generations")
+            {
+                genetic_generations = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--optimizer")
+            {
+                if (!Optimizer::parse_strategy(argv[i + 1], optimizer_strategy))
+                {
+                    std::cout << "Unknown optimizer " << argv[i + 1] << ", using genetic" << std::endl;
+                }
+            }
+            else if (argument == "--memetic")
+            {
+                memetic_interval = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--surrogate")
+            {
+                surrogate_fraction = std::min(1.f, std::max(0.f, std::stof(argv[i + 1])));
+            }
+            else if (argument == "--batch")
+            {
+                batch_images = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--checkpoint")
+            {
+                checkpoint_interval = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--islands")
+            {
+                islands = std::max(1ul, std::stoul(argv[i + 1]));
+            }
+            else if (argument == "--migration")
+            {
+                migration_interval = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--migrants")
+            {
+                migrants = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--topology")
+            {
+                if (!IslandModel::parse_topology(argv[i + 1], island_topology))
+                {
+                    std::cout << "Unknown topology " << argv[i + 1] << ", using ring" << std::endl;
+                }
+            }
+            else if (argument == "--island")
+            {
+                island = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--task")
+            {
+                island_task = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--mailbox")
+            {
+                island_mailbox = argv[i + 1];
+            }
+            else if (argument == "--patience")
+            {
+                convergence_patience = std::stoul(argv[i + 1]);
+            }
+            else if (argument == "--window")
+            {
+                convergence_window = std::max(1ul, std::stoul(argv[i + 1]));
+            }
+            else if (argument == "--min-improvement")
+            {
+                minimum_improvement = std::max(0.f, std::stof(argv[i + 1]));
+            }
+        }
+    }
+
+    /**
+    @brief Checks if the process is an island launched by island 0, that exits after its training
+    @return True for the launched islands
+    */
+    bool is_launched_island() const
+    {
+        return island > 0;
+    }
+
+    /**
+    @brief Train the neural network with mini-batch gradient descent over images of the given size
     @param image_width The width of the image
     @param image_height The height of the image
+    @param data_path The path of the network data. The training starts from it and exports the result to it
     */
-    void training(uint16_t image_width, uint16_t image_height);
+    void training(uint16_t image_width, uint16_t image_height, std::string data_path);
 
     /**
-    @brief Train the network with genetic algorithm
+    @brief Fits the network in closed form: streams the training set once to accumulate the normal equations
+    of the LUV transform and exports the best transform the tied weights can hold
+    @param image_width The width of the image
+    @param image_height The height of the image
+    @param data_path The path where the network data is exported
+    */
+    void least_squares(uint16_t image_width, uint16_t image_height, std::string data_path);
+
+    /**
+    @brief Train the network with genetic algorithm. Every image of a few gets all the generations, or with
+    batch_images every generation is scored over a new random batch of the whole training set. With
+    checkpoint_interval the run is saved next to the network data, and resume continues from there. With
+    convergence_patience an image ends once its fitness stops improving
     */
     void genetic_training(uint16_t image_width, uint16_t image_height, std::string data_path);
 
+    /**
+    @brief Loads batch_images random images of the training set, without repetition, as one sequence of pixels
+    @param path The folder of the training set
+    @param dataset_count The amount of images of the training set
+    @param image_input Buffer for the input values of one image
+    @param image_desired Buffer for the desired values of one image
+    @param input The input values of the batch
+    @param desired The desired values of the batch
+    */
+    void load_training_batch(const std::string& path, uint16_t dataset_count, std::vector<float>& image_input, std::vector<float>& image_desired, std::vector<float>& input, std::vector<float>& desired);
+
+    /**
+    @brief Maps the compiled training set, compiling the images whose PNG file changed since first. The launched
+    islands only map a file island 0 already compiled
+    @param path The folder of the training set
+    */
+    void open_dataset_cache(const std::string& path);
+
+    /**
+    @brief The values of an image of the training set, in the dataset cache or in the buffers given to load it
+    */
+    struct TrainingImage
+    {
+        const float* input;                 //< Three values per pixel
+        const float* desired;               //< Three values per pixel
+        size_t pixels;
+    };
+
+    /**
+    @brief Loads an image of the training set and its desired values. Both are read in place from the dataset cache
+    once it is open, or decoded from the PNG file
+    @param path The folder of the training set
+    @param index The image
+    @param input Buffer for the input values, used when the image is decoded from its PNG file
+    @param desired Buffer for the desired values, used when the image is decoded from its PNG file
+    @return The input and desired values of the image
+    */
+    TrainingImage load_training_image(const std::string& path, uint16_t index, std::vector<float>& input, std::vector<float>& desired);
+
+    /**
+    @brief Launches the other islands of the genetic training, this executable with the same command line and the
+    island, task, mailbox and seed of each one
+    @param mailbox The key of the shared memory of the islands
+    @return The processes launched
+    */
+    std::vector<std::unique_ptr<QProcess>> launch_islands(const std::string& mailbox);
+
+    /**
+    @brief Runs every optimizer, and the genetic one with the memetic polishing, from the same population over
+    the images of the genetic training and reports the evaluations each one needs to reach the best fitness found
+    @param image_width The width of the image
+    @param image_height The height of the image
+    */
+    void compare_optimizers(uint16_t image_width, uint16_t image_height);
+
 
     /**
     @brief Transform a given image 
@@ -181,6 +522,22 @@ public:
     */
     void transform(std::string filename, std::string data_path);
 
+    /**
+    @brief Measures the network passes over a training image and checks that the fast paths match the graph walk
+    @param image_width The width of the image
+    @param image_height The height of the image
+    */
+    void benchmark(uint16_t image_width, uint16_t image_height);
+
+    /**
+    @brief Measures the throughput of both modes of a batch function
+    @param name The name of the function
+    @param function The batch function
+    @param minimum The minimum value of the measured range
+    @param maximum The maximum value of the measured range
+    */
+    void benchmark_activation(std::string name, NNFastMath::batch_function function, float minimum, float maximum);
+
     /**
     @brief Extract the input for the neural network from a image data
     @param img The image with the data
@@ -295,60 +652,80 @@ public:
         @param networks The collection of networks
         @param amount The amount to networks to add
         */
-        void initialize_networks(std::vector<std::shared_ptr<NeuralNetwork>>& networks, uint8_t amount)
+        void initialize_networks(std::pmr::vector<TiedNeuralNetwork>& networks, uint32_t amount)
         {
-            int iterator = 0;
+            uint32_t iterator = 0;
             while (iterator < amount)
             {
-                networks[iterator] = std::make_shared<NeuralNetwork>(500 * 500 * 3);
+                networks.emplace_back(uint32_t(500 * 500 * 3));
                 ++iterator;
             }
         }
 
         /**
-        @brief Recombine the given network parents 
-        @param parent_1_index The index of the firs parent
-        @param parent_2_index The index of the second parent
+        @brief Exports a chromosome through a network of the population
+        @param network The network that takes the weights
+        @param chromosome The 6 weights
+        @param data_path The path of the exported data
         */
-        void recombine_networks(std::vector<std::shared_ptr<NeuralNetwork>>& networks,  uint8_t parent_1_index, uint8_t parent_2_index)
-        {          
-            BinaryData parent_1_binary_data = networks[parent_1_index]->get_binary_data();
-            BinaryData parent_2_binary_data = networks[parent_2_index]->get_binary_data();
+        void export_chromosome(TiedNeuralNetwork& network, const std::array<float, Optimizer::genes>& chromosome, std::string data_path)
+        {
+            BinaryData data = network.get_binary_data();
+
+            data.wa = chromosome[0];
+            data.wb = chromosome[1];
+            data.wc = chromosome[2];
+            data.wd = chromosome[3];
+            data.we = chromosome[4];
+            data.wf = chromosome[5];
+
+            network.apply_binary_data(data);
+            network.export_network(data_path);
+        }
 
-            for (auto& net : networks)
+        /**
+        @brief Gets the evaluations after which the best fitness of a run reached a target
+        @param history The evaluations and the best fitness after each generation
+        @param target The target fitness
+        @return The evaluations, 0 if the target was never reached
+        */
+        uint64_t get_evaluations_to_target(const std::vector<std::pair<uint64_t, float>>& history, float target)
+        {
+            for (const auto& entry : history)
             {
-                BinaryData network_data = net->get_binary_data();
-
-                //For each component                               
-                recombine_weights(network_data.wa, parent_1_binary_data.wa, parent_2_binary_data.wa);
-                recombine_weights(network_data.wb, parent_1_binary_data.wb, parent_2_binary_data.wb);
-                recombine_weights(network_data.wc, parent_1_binary_data.wc, parent_2_binary_data.wc);
-                recombine_weights(network_data.wd, parent_1_binary_data.wd, parent_2_binary_data.wd);
-                recombine_weights(network_data.we, parent_1_binary_data.we, parent_2_binary_data.we);
-                recombine_weights(network_data.wf, parent_1_binary_data.wf, parent_2_binary_data.wf);
-
-                net->apply_binary_data(network_data);
-            }           
+                if (entry.second <= target)
+                {
+                    return entry.first;
+                }
+            }
+
+            return 0;
         }
 
         /**
-        @brief Recombine the given weights and mutate if needed
-        @param original The param where the new value will be stored
-        @param parent_1_value The value of the first parent
-        @param parent_2_value The value of the second parent
+        @brief Calculates the fitness of a network output as the sum of the delta color of every pixel. Lower is better
+        @param output The output values of the network
+        @param desired The desired values
+        @return The fitness
         */
-        void recombine_weights(float& original, float& parent_1_value, float& parent_2_value)
+        float calculate_fitness(const std::vector<float>& output, const std::vector<float>& desired)
         {
-            const float parent_1_prob = 0.45f;
-            const float parent_2_prob = 0.45f;
-            const float mutation_prob = 0.1f;
+            size_t iterator = 0;
+            float delta = 0;
 
-            float action = (float(rand()) / RAND_MAX);
-            
-            original = action < parent_1_prob                 ? parent_1_value :
-                       action < parent_1_prob + parent_2_prob ? parent_2_value : 
-                                                                (float(rand()) / RAND_MAX) * (5.f - (-5.f)) + (-5.f);
-   
+            while (iterator < output.size())
+            {
+                Pixel first;
+                Pixel second;
+
+                first.luv_components  = Pixel::LUV(output[iterator], output[iterator + 1], output[iterator + 2]);
+                second.luv_components = Pixel::LUV(desired[iterator], desired[iterator + 1], desired[iterator + 2]);
+
+                delta += calculate_delta(first, second);
+                iterator += 3;
+            }
+
+            return delta;
         }
 
         /**
@@ -1,78 +1,68 @@
 #pragma once
 
 #include <cstdint>
-#include <random>
+#include <cstddef>
 
-/** 
- * @brief Class that manages the data of a neuron 
+/**
+ * @brief Compatibility view over the data of a neuron.
+ * The values, deltas and weights are owned by the layer in contiguous arrays, this class only points into them.
 */
 class Neuron
 {
 private:
 
-    struct 
+    struct
     {
         float * values;
         uint8_t size;
     } weights;
 
-    float value = 0.f;
-    float delta = 0.f;
+    float * value;
+    float * delta;
 
-public: 
+public:
 
     /**
-     * @brief Creates a neuron with the given amount of weights
+     * @brief Creates a view of a neuron stored in a layer
+     * @param value The address of the neuron value inside the layer
+     * @param delta The address of the neuron delta inside the layer
+     * @param weights_values The address of the first weight of the neuron inside the layer
      * @param weights_size The amount of weights (correspond to the amount of neurons in the previous layer)
      */
-    Neuron(uint8_t weigths_size) 
+    Neuron(float * value, float * delta, float * weights_values, uint8_t weights_size)
+        :
+        value {value},
+        delta {delta}
     {
-        weights.size    = weigths_size;
-        weights.values  = new float [weigths_size];        
-
-        float * start   = weights.values;
-        float * end     = start + weights.size;
-
-        while (start < end)
-        {
-            (*start) = (float (rand()) / RAND_MAX) * (5.f - (-5.f)) + (-5.f);
-            ++start;
-        }
+        weights.values  = weights_values;
+        weights.size    = weights_size;
     }
 
     /**
-     * @brief Frees the memory
+     * @brief Gets the delta value
+     * @return The delta value
     */
-    ~Neuron()
+    float get_delta () const
     {
-        delete [] weights.values;
+        return *delta;
     }
 
-    /**
-     * @brief Gets the delta value 
-     * @return The delta value
-    */
-    float get_delta () const 
-    { 
-        return delta;
-    }
-    
     /**
      * @brief Gets the value of the neuron
      * @return The value of the neuron
     */
-    float get_value () const 
-    { 
-        return value;
+    float get_value () const
+    {
+        return *value;
     }
 
     /**
      * @brief Gets a pointer to the weights values
      * @return The pointer to the weights values
     */
-    float * get_weights() 
-    { 
-        return weights.values; 
+    float * get_weights()
+    {
+        return weights.values;
     }
 
     /**
@@ -89,27 +79,27 @@ public:
      * @brief Gets the amount of weights of this neuron
      * @return The amount of weights of this neuron
     */
-    uint8_t get_weights_size() 
+    uint8_t get_weights_size()
     {
         return weights.size;
     }
 
-    /** 
+    /**
      * @brief Set the delta of this neuron
      * @param delta The delta to set
     */
-    void set_delta (float delta) 
+    void set_delta (float delta)
     {
-        this->delta = delta;
+        *(this->delta) = delta;
     }
-    
+
     /**
      * @brief Set the value of this neuron
      * @param value The value of this neuron
     */
     void set_value (float value)
     {
-        this->value = value;
+        *(this->value) = value;
     }
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <Checkpoint.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+@brief Search strategy over the 6 tied weights, driven with ask and tell: ask gives a batch of chromosomes to
+evaluate, tell gives back their fitness (lower is better). The evaluation is left to the caller, so every
+strategy runs over the same PopulationEvaluator, fitness cache and early rejection.
+*/
+class Optimizer
+{
+public:
+
+    static constexpr size_t genes = 6;
+
+    enum strategies {GENETIC, CMA_ES, DIFFERENTIAL_EVOLUTION};
+
+protected:
+
+    std::array<float, genes> best_chromosome {};
+    float best_fitness = std::numeric_limits<float>::max();
+    uint64_t evaluations = 0;
+
+public:
+
+    virtual ~Optimizer() = default;
+
+    /**
+    @brief Creates an optimizer
+    @param strategy The strategy
+    @param population The first population, 6 weights per chromosome
+    @return The optimizer
+    */
+    static std::unique_ptr<Optimizer> create(strategies strategy, const std::vector<float>& population);
+
+    /**
+    @brief Gets the strategy of a name given in the command line
+    @param name genetic, cmaes or de
+    @param strategy The strategy of the name
+    @return True if the name is known
+    */
+    static bool parse_strategy(const std::string& name, strategies& strategy);
+
+    /**
+    @brief Gets the name of the strategy
+    @return The name
+    */
+    virtual const char* get_name() const = 0;
+
+    /**
+    @brief Gets the chromosomes to evaluate next
+    @param chromosomes Filled with 6 weights per chromosome
+    */
+    virtual void ask(std::vector<float>& chromosomes) = 0;
+
+    /**
+    @brief Gives the fitness of the chromosomes of the last ask
+    @param chromosomes The chromosomes of the last ask
+    @param fitness The fitness of each chromosome. Only the get_selected_count() best need to be exact, the
+    others can be lower bounds above them, or the maximum float for the ones not evaluated
+    */
+    void tell(const std::vector<float>& chromosomes, const std::vector<float>& fitness);
+
+    /**
+    @brief Gets how many of the best chromosomes of a batch need an exact fitness
+    @param candidates The amount of chromosomes of the batch
+    @return The amount of chromosomes
+    */
+    virtual size_t get_selected_count(size_t candidates) const = 0;
+
+    /**
+    @brief Checks if some chromosomes of a batch can be told without evaluation, with the maximum fitness, as a
+    surrogate model screens them out
+    @return True if the strategy only loses those chromosomes
+    */
+    virtual bool accepts_screening() const
+    {
+        return true;
+    }
+
+    /**
+    @brief Checks if some chromosomes of a batch can be replaced, before the evaluation by the migrants of
+    another island or after it by the polished elites of the memetic refiner
+    @return True if the strategy treats them as any other chromosome of the batch
+    */
+    virtual bool accepts_migrants() const
+    {
+        return true;
+    }
+
+    /**
+    @brief Tells the strategy that the fitness of a chromosome changes from one tell to the next, as when each
+    generation is scored over another batch of images. The strategies that keep fitness values across tells
+    score those chromosomes again with every batch
+    @param rescoring True if the fitness changes
+    */
+    virtual void set_rescoring(bool /*rescoring*/)
+    {
+    }
+
+    /**
+    @brief Forgets the fitness values known, for example when the training image changes
+    */
+    virtual void reset_fitness()
+    {
+        best_fitness = std::numeric_limits<float>::max();
+    }
+
+    /**
+    @brief Gets the best chromosome told since the last reset
+    @return The 6 weights
+    */
+    const std::array<float, genes>& get_best_chromosome() const
+    {
+        return best_chromosome;
+    }
+
+    /**
+    @brief Gets the fitness of the best chromosome told since the last reset
+    @return The fitness
+    */
+    float get_best_fitness() const
+    {
+        return best_fitness;
+    }
+
+    /**
+    @brief Gets the amount of chromosomes told with a fitness since the optimizer was created
+    @return The amount of evaluations
+    */
+    uint64_t get_evaluations() const
+    {
+        return evaluations;
+    }
+
+    /**
+    @brief Writes the state of the optimizer to a checkpoint, between a tell and the next ask
+    @param writer The payload of the checkpoint
+    */
+    void save(CheckpointWriter& writer) const;
+
+    /**
+    @brief Restores the state written by save. The optimizer must have the strategy and the population size of the
+    one saved, the settings are not part of the state
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold the state
+    */
+    bool load(CheckpointReader& reader);
+
+protected:
+
+    /**
+    @brief Writes the state of the strategy
+    @param writer The payload of the checkpoint
+    */
+    virtual void save_state(CheckpointWriter& writer) const = 0;
+
+    /**
+    @brief Restores the state of the strategy
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold the state
+    */
+    virtual bool load_state(CheckpointReader& reader) = 0;
+
+    /**
+    @brief Updates the strategy with the fitness of the chromosomes of the last ask
+    @param chromosomes The chromosomes of the last ask
+    @param fitness The fitness of each chromosome
+    */
+    virtual void update(const std::vector<float>& chromosomes, const std::vector<float>& fitness) = 0;
+};
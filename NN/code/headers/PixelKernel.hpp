@@ -0,0 +1,105 @@
+#pragma once
+
+#include <BinaryData.hpp>
+#include <NNActivations.hpp>
+#include <NNFastMath.hpp>
+#include <Simd.hpp>
+#include <ThreadPool.hpp>
+#include <cstddef>
+
+/**
+@brief The proposed network folded into a per pixel kernel.
+Each pixel goes through 3 inputs -> 1 hidden neuron -> 3 outputs with the same tied weights and the same
+activations of the layers, so the result is the same as walking the layers of the network.
+The loops are templated on the activation policies; the runtime activation types only select, once at
+construction, which instantiation runs.
+*/
+class PixelKernel
+{
+private:
+
+    typedef void (*run_function) (const PixelKernel& kernel, const float* input, float* output, float* hidden, size_t pixels);
+
+    float hidden_weights[3];
+    float output_weights[3];
+
+    run_function runner;            //< Instantiation for the activations with the widest instruction set
+    run_function scalar_runner;     //< Instantiation for the activations one pixel at a time
+
+public:
+
+    /**
+    @brief Compiles the kernel of a network
+    @param data The tied weights of the network
+    @param hidden_activation The activation of the hidden layer
+    @param output_activation The activation of the output layer
+    @param mode The precision of the activations. FAST replaces sigmoid and tanh with the NNFastMath approximations
+    */
+    PixelKernel (
+                    const BinaryData& data,
+                    NNActivations::activations hidden_activation = NNActivations::RELU,
+                    NNActivations::activations output_activation = NNActivations::RELU,
+                    NNFastMath::modes mode = NNFastMath::PRECISE
+                );
+
+    /**
+    @brief Calculates the outputs of a single pixel
+    @param input The first of the three input values of the pixel
+    @param output The first of the three output values of the pixel
+    @return The hidden value of the pixel
+    */
+    float apply(const float* input, float* output) const
+    {
+        float hidden;
+        scalar_runner(*this, input, output, &hidden, 1);
+        return hidden;
+    }
+
+    /**
+    @brief Calculates the outputs of a collection of pixels
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param pixels The amount of pixels
+    */
+    void run(const float* input, float* output, size_t pixels) const
+    {
+        runner(*this, input, output, nullptr, pixels);
+    }
+
+    /**
+    @brief Calculates the outputs of a collection of pixels keeping the hidden values
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel
+    @param pixels The amount of pixels
+    */
+    void run(const float* input, float* output, float* hidden, size_t pixels) const
+    {
+        runner(*this, input, output, hidden, pixels);
+    }
+
+    /**
+    @brief Calculates the outputs of a collection of pixels splitting them in chunks between the threads of a pool.
+    The pixels are independent, so the result is the same as the one of a single thread
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+    @param pixels The amount of pixels
+    @param pool The threads
+    */
+    void run(const float* input, float* output, float* hidden, size_t pixels, ThreadPool& pool) const;
+
+private:
+
+    /**
+    @brief Calculates the outputs of a collection of pixels with the given instruction set, the pixels that
+    do not fill a vector are calculated one by one
+    @param kernel The kernel with the weights
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+    @param pixels The amount of pixels
+    */
+    template <class Hidden, class Output, Simd::instruction_sets set>
+    static void run_pixels(const PixelKernel& kernel, const float* input, float* output, float* hidden, size_t pixels);
+};
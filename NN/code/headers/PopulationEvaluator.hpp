@@ -0,0 +1,82 @@
+#pragma once
+
+#include <NNActivations.hpp>
+#include <NNFastMath.hpp>
+#include <Simd.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+@brief Scores a whole population of tied networks in a single pass over an image.
+The chromosomes are a contiguous matrix of 6 weights per candidate (wa, wb, wc, wd, we, wf). The image is walked
+in blocks of block_pixels pixels; each block is split into one array per component while it is in L1 and every
+candidate runs over it, adding the LUV delta of each pixel, times the amount of pixels it stands for, to its
+fitness. Lower fitness is better.
+The blocks of a thread pool chunk are added in order and the chunks with the fixed tree, so the fitness does not
+depend on the amount of threads.
+*/
+class PopulationEvaluator
+{
+public:
+
+    static constexpr size_t genes = 6;              //< Weights per chromosome
+    static constexpr size_t block_pixels = 256;     //< 7 KB of split components, desired values and counts
+
+private:
+
+    typedef void (*block_function) (const float* chromosomes, size_t candidates, const float* components, size_t pixels, double* fitness);
+
+    block_function block_runner;    //< Instantiation for the activations with the widest instruction set
+
+    double last_seconds = 0.0;
+    double last_pixel_candidates = 0.0;
+
+public:
+
+    /**
+    @brief Creates an evaluator for networks with the given activations
+    @param hidden_activation The activation of the hidden layer
+    @param output_activation The activation of the output layer
+    @param mode The precision of the activations
+    */
+    PopulationEvaluator (
+                            NNActivations::activations hidden_activation = NNActivations::RELU,
+                            NNActivations::activations output_activation = NNActivations::RELU,
+                            NNFastMath::modes mode = NNFastMath::PRECISE
+                        );
+
+    /**
+    @brief Calculates the fitness of every candidate: the sum over the pixels of the LUV delta between the output of
+    the candidate and the desired values
+    @param chromosomes The first weight of the matrix. 6 weights per candidate
+    @param candidates The amount of candidates
+    @param input The first input value. Three values per pixel
+    @param desired The first desired value. Three values per pixel
+    @param counts The amount of pixels each pixel stands for, as in a colour table. nullptr for one each
+    @param pixels The amount of pixels
+    @param fitness The first fitness. One per candidate
+    */
+    void evaluate(const float* chromosomes, size_t candidates, const float* input, const float* desired, const float* counts, size_t pixels, float* fitness);
+
+    /**
+    @brief Gets the throughput of the last evaluation
+    @return The pixel-candidates evaluated per second
+    */
+    double get_throughput() const
+    {
+        return last_seconds > 0.0 ? last_pixel_candidates / last_seconds : 0.0;
+    }
+
+private:
+
+    /**
+    @brief Adds the deltas of a block of pixels to the fitness of every candidate
+    @param chromosomes The first weight of the matrix. 6 weights per candidate
+    @param candidates The amount of candidates
+    @param components The block split in 7 arrays of block_pixels values: l, u, v, the desired l, u, v and the counts
+    @param pixels The amount of pixels of the block
+    @param fitness The first fitness. One per candidate
+    */
+    template <class Hidden, class Output, Simd::instruction_sets set>
+    static void run_block(const float* chromosomes, size_t candidates, const float* components, size_t pixels, double* fitness);
+};
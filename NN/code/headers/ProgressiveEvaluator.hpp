@@ -0,0 +1,131 @@
+#pragma once
+
+#include <PopulationEvaluator.hpp>
+#include <ColorHistogram.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+@brief Coarse to fine fitness of a population that stops scoring the candidates that can not be selected.
+The optimizer selects the k best candidates of a batch, two for the genetic algorithm.
+The colour table of an image is reordered once in a pyramid of levels: every 64th colour, then every 16th, every
+4th and the rest, so each level samples the whole image. Every level is scored for all the candidates still alive
+and the weighted deltas are never negative, so the sum of the levels scored is a lower bound of the fitness. A candidate whose bound is
+above the k-th best complete fitness can not be selected and is rejected, so the selection is the one a full
+evaluation would give.
+*/
+class ProgressiveEvaluator
+{
+public:
+
+    static constexpr size_t levels = 4;
+
+    /**
+    @brief Counters since the evaluator was created
+    */
+    struct Statistics
+    {
+        uint64_t candidates = 0;
+        uint64_t rejected = 0;
+        uint64_t pixel_candidates = 0;          //< Colours scored, added over the candidates
+        uint64_t full_pixel_candidates = 0;     //< Colours a full evaluation would have scored
+    };
+
+private:
+
+    PopulationEvaluator& evaluator;
+
+    std::vector<float> input;                   //< The colours of the image in pyramid order, three values per colour
+    std::vector<float> desired;
+    std::vector<float> counts;
+    std::array<size_t, levels + 1> level_first {};
+    std::array<double, levels + 1> level_weight {};   //< Pixels of the levels before each one
+
+    std::vector<double> totals;
+    std::vector<size_t> alive;
+    std::vector<float> rows;                    //< The chromosomes of the candidates scored on a level
+    std::vector<float> level_fitness;
+    std::vector<float> best_values;             //< The k best complete fitness values, in order
+    std::vector<float> estimates;               //< Fitness of each candidate of the last evaluation, extrapolated if rejected
+
+    Statistics statistics;
+
+public:
+
+    /**
+    @brief Creates a progressive evaluator
+    @param evaluator The evaluator that scores each level
+    */
+    explicit ProgressiveEvaluator(PopulationEvaluator& evaluator) : evaluator{evaluator}
+    {
+    }
+
+    /**
+    @brief Builds the pyramid of an image
+    @param histogram The colour table of the image
+    */
+    void set_image(const ColorHistogram& histogram);
+
+    /**
+    @brief Scores a population. The candidates that can not be in the k best get a lower bound of their fitness
+    @param chromosomes The first weight of the matrix. 6 weights per candidate
+    @param candidates The amount of candidates
+    @param selected k, the amount of best candidates that must be exact
+    @param known The fitness values known before the evaluation that compete for the selection, for example of
+    the cached candidates
+    @param fitness The first fitness. One per candidate
+    @param complete Set to 1 for the candidates fully scored and 0 for the rejected ones
+    */
+    void evaluate(const float* chromosomes, size_t candidates, size_t selected, const std::vector<float>& known, float* fitness, std::vector<uint8_t>& complete);
+
+    /**
+    @brief Gets an estimate of the fitness of every candidate of the last evaluation: the fitness of the complete
+    ones and, for the rejected ones, the levels scored scaled to the pixels of the whole image. Each level samples
+    the whole image, so the estimate is close to the fitness, but it is not a bound
+    @return The estimates, one per candidate
+    */
+    const std::vector<float>& get_estimates() const
+    {
+        return estimates;
+    }
+
+    /**
+    @brief Gets the counters since the evaluator was created
+    @return The counters
+    */
+    const Statistics& get_statistics() const
+    {
+        return statistics;
+    }
+
+private:
+
+    /**
+    @brief Scores the alive candidates on a level and adds the result to their totals
+    @param chromosomes The first weight of the matrix of all the candidates
+    @param level The level
+    */
+    void score_level(const float* chromosomes, size_t level);
+
+    /**
+    @brief Gets the level of a colour of the pyramid
+    @param index The index of the colour in the table
+    @return 0 for every 64th colour to levels - 1 for the colours on no level before
+    */
+    static size_t get_level(size_t index)
+    {
+        size_t level = levels - 1;
+
+        for (size_t step = 4; step <= 64; step *= 4)
+        {
+            if (index % step == 0)
+            {
+                --level;
+            }
+        }
+
+        return level;
+    }
+};
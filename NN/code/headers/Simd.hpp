@@ -0,0 +1,45 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+    #define NN_TARGET_AVX2
+#else
+    #define NN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/**
+@brief Detection of the vector instruction sets available on the processor.
+The functions that use AVX2 are marked with NN_TARGET_AVX2 so the rest of the code keeps the baseline flags.
+*/
+class Simd
+{
+public:
+
+    /**
+    @brief The instruction sets the vectorized code can run with. The widest one supported is chosen at runtime
+    */
+    enum instruction_sets {SCALAR, SSE2, AVX2};
+
+    /**
+    @brief Gets the widest instruction set supported by the processor. Detected once
+    @return The instruction set
+    */
+    static instruction_sets get_instruction_set();
+
+    /**
+    @brief Gets the name of an instruction set
+    @param set The instruction set
+    @return The name
+    */
+    static const char* get_name(instruction_sets set)
+    {
+        switch (set)
+        {
+            case AVX2: return "AVX2";
+            case SSE2: return "SSE2";
+            default: return "scalar";
+        }
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <Checkpoint.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+@brief Online quadratic model of the fitness of a chromosome, used to pre-screen the chromosomes of a generation.
+The logarithm of the fitness is fitted with ridge regression over the last evaluations of the image, with the 28
+features 1, the 6 weights and their 21 products, with the weights standardized over the evaluations fitted. The
+fitness of the ReLU network is a product of the weights of both layers, so the logarithm is closer to a quadratic
+than the fitness itself. The model only ranks the chromosomes: the ones kept get a real evaluation and the others
+no fitness at all.
+*/
+class SurrogateModel
+{
+public:
+
+    static constexpr size_t genes = 6;
+    static constexpr size_t features = 28;     //< 1, the genes and the products of every pair of genes
+
+    /**
+    @brief Counters since the model was created
+    */
+    struct Statistics
+    {
+        uint64_t proposed = 0;                  //< Chromosomes given to screen while the model was ready
+        uint64_t screened_out = 0;              //< Chromosomes that got no real evaluation
+        uint64_t predictions = 0;               //< Predictions compared with an evaluation
+        double error_sum = 0.0;                 //< Sum of the relative errors of the predictions
+        double last_error = 0.0;                //< Mean relative error of the predictions of the last learn call
+    };
+
+private:
+
+    size_t capacity;
+    double ridge;
+
+    std::vector<std::array<float, genes>> samples;     //< Ring of the last evaluations
+    std::vector<float> values;                          //< Logarithm of their fitness
+    size_t next = 0;
+
+    std::array<double, features> coefficients {};
+    std::array<double, genes> center {};
+    std::array<double, genes> scale {};
+    bool fitted = false;
+
+    std::vector<float> predictions;             //< Prediction of each chromosome kept by the last screen, 0 if none
+
+    Statistics statistics;
+
+public:
+
+    /**
+    @brief Creates an empty model
+    @param capacity The amount of last evaluations fitted
+    @param ridge The regularization, relative to the diagonal of the normal equations
+    */
+    explicit SurrogateModel(size_t capacity = 256, double ridge = 1e-3) : capacity{capacity}, ridge{ridge}
+    {
+    }
+
+    /**
+    @brief Forgets the evaluations, for example when the image changes. The counters are kept
+    */
+    void clear();
+
+    /**
+    @brief Checks if there are enough evaluations to fit the model
+    @return True with twice as many evaluations as features
+    */
+    bool is_ready() const
+    {
+        return samples.size() >= 2 * features;
+    }
+
+    /**
+    @brief Predicts the fitness of a chromosome. The model must be ready
+    @param chromosome The 6 weights
+    @return The predicted fitness
+    */
+    float predict(const float* chromosome);
+
+    /**
+    @brief Keeps the most promising chromosomes of a batch. While the model is not ready every chromosome is kept
+    @param chromosomes The first weight of the matrix. 6 weights per chromosome
+    @param count The amount of chromosomes
+    @param kept The amount of chromosomes to keep
+    @param screened Filled with the kept chromosomes, in the order of the batch
+    @param indices Filled with the index in the batch of every kept chromosome
+    @return The amount of chromosomes kept
+    */
+    size_t screen(const float* chromosomes, size_t count, size_t kept, std::vector<float>& screened, std::vector<size_t>& indices);
+
+    /**
+    @brief Adds the evaluations of the chromosomes of the last screen and measures the error of their predictions
+    @param screened The chromosomes of the last screen
+    @param fitness The fitness of each one, or an estimate as ProgressiveEvaluator::get_estimates gives
+    @param count The amount of chromosomes
+    */
+    void learn(const float* screened, const float* fitness, size_t count);
+
+    /**
+    @brief Writes the evaluations kept to a checkpoint. The fit is computed again from them
+    @param writer The payload of the checkpoint
+    */
+    void save(CheckpointWriter& writer) const;
+
+    /**
+    @brief Restores the evaluations written by save
+    @param reader The payload of the checkpoint
+    @return False if the payload does not hold the evaluations
+    */
+    bool load(CheckpointReader& reader);
+
+    /**
+    @brief Gets the counters since the model was created
+    @return The counters
+    */
+    const Statistics& get_statistics() const
+    {
+        return statistics;
+    }
+
+private:
+
+    /**
+    @brief Solves the ridge regression of the evaluations kept
+    */
+    void fit();
+
+    /**
+    @brief Gets the features of a chromosome
+    @param chromosome The 6 weights
+    @param values The 28 features
+    */
+    void get_features(const float* chromosome, double* values) const;
+};
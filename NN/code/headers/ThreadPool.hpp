@@ -0,0 +1,272 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+@brief Fixed set of worker threads that run the chunks of the network passes.
+The work is always split in chunks of chunk_pixels pixels, whatever the amount of threads, and every chunk writes
+its own partial results. Reducing the partials with tree_reduce gives the same sums with any amount of threads.
+Every thread has its own deque of tasks: a run pushes its tasks to the deque of the calling thread, which takes
+them from the back, and the threads without tasks steal them from the front of the other deques. Runs can be
+nested: a thread waiting for its run keeps taking and stealing tasks, so a task can start its own parallel run,
+for example the evaluation of a network that runs its passes in parallel. A thread with nothing to take or steal
+sleeps until tasks are pushed or its own run finishes. An exception thrown by a task is thrown again by run once
+the other tasks of the run finish.
+*/
+class ThreadPool
+{
+public:
+
+    /**
+    @brief The amount of pixels of each chunk. A multiple of every vector width
+    */
+    static constexpr size_t chunk_pixels = 16384;
+
+private:
+
+    /**
+    @brief The tasks of a run. Lives on the stack of the thread that called run
+    */
+    struct Job
+    {
+        const std::function<void(size_t)>* function;
+        size_t count;
+        std::atomic<size_t> finished;
+        std::atomic<bool> failed;               //< A task threw, the tasks not started yet are skipped
+        std::exception_ptr error;               //< The first exception, written by the task that set failed
+    };
+
+    /**
+    @brief A task of a run
+    */
+    struct Task
+    {
+        Job* job;
+        size_t index;
+    };
+
+    /**
+    @brief The tasks pushed by a thread. The owner takes from the back, the other threads steal from the front
+    */
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;     //< The first one for the threads outside the pool, then one per worker
+
+    std::mutex mutex;
+    std::condition_variable work_condition;     //< Tasks were pushed, the last task of a run finished or the pool stops
+
+    std::atomic<size_t> queued {0};            //< Tasks in the queues
+    bool stopping = false;
+
+    static thread_local const ThreadPool* worker_pool;     //< The pool of the calling thread, if it is a worker
+    static thread_local size_t worker_queue;                //< The queue of the calling thread, if it is a worker
+
+public:
+
+    /**
+    @brief Creates a pool. The calling thread also runs tasks, so threads_count - 1 workers are created
+    @param threads_count The amount of threads that run the tasks, 0 for all the hardware threads
+    */
+    explicit ThreadPool(size_t threads_count = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    /**
+    @brief Stops the workers
+    */
+    ~ThreadPool();
+
+    /**
+    @brief Gets the pool shared by the networks
+    @return The pool
+    */
+    static ThreadPool& get()
+    {
+        static ThreadPool instance;
+        return instance;
+    }
+
+    /**
+    @brief Changes the amount of threads. Must not be called while a run is in progress
+    @param threads_count The amount of threads that run the tasks, 0 for all the hardware threads
+    */
+    void set_threads_count(size_t threads_count);
+
+    /**
+    @brief Gets the amount of threads that run the tasks, the calling one included
+    @return The amount of threads
+    */
+    size_t get_threads_count() const
+    {
+        return workers.size() + 1;
+    }
+
+    /**
+    @brief Runs a task for each index in [0, tasks) and waits until all of them finish. The order in which the
+    tasks run is not defined, so each one must write to its own results. Tasks can call run again. If a task
+    throws, the tasks not started yet are skipped and the first exception is thrown once the started ones finish
+    @param tasks The amount of tasks
+    @param function The task, called with the task index
+    */
+    void run(size_t tasks, const std::function<void(size_t)>& function);
+
+    /**
+    @brief Gets the amount of chunks a collection of pixels is split in
+    @param pixels The amount of pixels
+    @return The amount of chunks
+    */
+    static size_t get_chunks_count(size_t pixels)
+    {
+        return (pixels + chunk_pixels - 1) / chunk_pixels;
+    }
+
+    /**
+    @brief Runs a function over a collection of pixels split in chunks
+    @param pixels The amount of pixels
+    @param function Called with the chunk index, the first pixel and the end pixel of the chunk
+    */
+    template <class Function>
+    void parallel_for(size_t pixels, Function&& function)
+    {
+        run(get_chunks_count(pixels), [&](size_t chunk)
+        {
+            size_t begin = chunk * chunk_pixels;
+            size_t end = begin + chunk_pixels < pixels ? begin + chunk_pixels : pixels;
+
+            function(chunk, begin, end);
+        });
+    }
+
+    /**
+    @brief Adds the partial results of the chunks pairwise: 0+1, 2+3, ... then 0+2, 4+6, ...
+    The shape of the tree only depends on the amount of partials, so the result does not depend on the threads.
+    @param partials The partial results, one per chunk. They are overwritten
+    @return The sum of all the partials
+    */
+    template <class T, size_t N>
+    static std::array<T, N> tree_reduce(std::vector<std::array<T, N>>& partials)
+    {
+        std::array<T, N> result {};
+
+        if (partials.empty())
+        {
+            return result;
+        }
+
+        for (size_t step = 1; step < partials.size(); step *= 2)
+        {
+            for (size_t i = 0; i + step < partials.size(); i += 2 * step)
+            {
+                for (size_t k = 0; k < N; ++k)
+                {
+                    partials[i][k] += partials[i + step][k];
+                }
+            }
+        }
+
+        return partials[0];
+    }
+
+    /**
+    @brief Adds partial results of any length with the same tree as the fixed size version
+    @param partials The partial results, one per chunk, all of the given length. They are overwritten
+    @param length The length of the partials, the one of the zeros returned when there are no chunks
+    @return The sum of all the partials
+    */
+    template <class T>
+    static std::vector<T> tree_reduce(std::vector<std::vector<T>>& partials, size_t length)
+    {
+        if (partials.empty())
+        {
+            return std::vector<T>(length, T {});
+        }
+
+        for (size_t step = 1; step < partials.size(); step *= 2)
+        {
+            for (size_t i = 0; i + step < partials.size(); i += 2 * step)
+            {
+                for (size_t k = 0; k < partials[i].size(); ++k)
+                {
+                    partials[i][k] += partials[i + step][k];
+                }
+            }
+        }
+
+        return partials[0];
+    }
+
+private:
+
+    /**
+    @brief Creates the workers
+    @param threads_count The amount of threads that run the tasks, 0 for all the hardware threads
+    */
+    void start(size_t threads_count);
+
+    /**
+    @brief Stops and joins the workers
+    */
+    void stop();
+
+    /**
+    @brief Loop of a worker thread, takes and steals tasks and sleeps when there are none
+    @param queue The queue of the worker
+    */
+    void work(size_t queue);
+
+    /**
+    @brief Gets the queue of the calling thread
+    @return The index of the queue
+    */
+    size_t get_queue() const
+    {
+        return worker_pool == this ? worker_queue : 0;
+    }
+
+    /**
+    @brief Takes a task from the back of a queue of the calling thread or else steals one from the front of
+    the other queues, starting with the next one
+    @param queue The queue of the calling thread
+    @param task The task taken
+    @return True if a task was taken
+    */
+    bool take_task(size_t queue, Task& task);
+
+    /**
+    @brief Sleeps until there are tasks to take, the pool stops or the given condition holds
+    @param condition Checked with the mutex locked
+    @return True if the pool stops
+    */
+    template <class Condition>
+    bool wait_for_tasks(Condition&& condition)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_condition.wait(lock, [&]() { return stopping || queued.load() > 0 || condition(); });
+
+        return stopping;
+    }
+
+    /**
+    @brief Runs a task taken with take_task and wakes the owner of the job after its last task. The exception of
+    a task is kept in its job
+    @param task The task
+    */
+    void execute(const Task& task);
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <BinaryData.hpp>
+#include <NNActivations.hpp>
+#include <NNRandom.hpp>
+#include <PixelKernel.hpp>
+#include <ThreadPool.hpp>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+@brief The proposed network expressed with its shared parameters only.
+Every hidden neuron uses the same wa, wb, wc and every output triplet uses the same wd, we, wf, so the
+chromosome is the whole network. Applying a chromosome is a copy of six floats and a network costs a few bytes.
+The activations needed by the back propagation live in a Scratch buffer that can be reused between networks.
+*/
+class TiedNeuralNetwork
+{
+public:
+
+    /**
+    @brief Reusable buffers with the per neuron data of a network pass
+    */
+    struct Scratch
+    {
+        std::vector<float> hidden_values;
+
+        /**
+        @brief Prepares the buffers for a network with the given amount of input neurons
+        @param first_layer_neurons The amount of neurons in the input layer
+        */
+        void resize(uint32_t first_layer_neurons)
+        {
+            hidden_values.resize(first_layer_neurons / 3);
+        }
+    };
+
+    /**
+    @brief Gradients of the squared error 0.5 * |output - desired|^2 summed over the pixels of a pass
+    */
+    struct Gradients
+    {
+        std::array<double, 6> weights {};     //< In the order of BinaryData: wa, wb, wc, wd, we, wf
+        double error = 0.0;
+        uint64_t pixels = 0;
+    };
+
+private:
+
+    BinaryData parameters;
+    float learning_rate = 0.01f;
+
+    NNActivations::activations hidden_activation = NNActivations::RELU;
+    NNActivations::activations output_activation = NNActivations::RELU;
+    NNFastMath::modes math_mode = NNFastMath::PRECISE;
+
+public:
+
+    /**
+    @brief Creates a network with random parameters
+    @param first_layer_neurons The amount of neurons in the input layer
+    */
+    TiedNeuralNetwork(uint32_t first_layer_neurons);
+
+    /**
+    @brief Creates a network with the given parameters
+    @param data The parameters of the network
+    */
+    TiedNeuralNetwork(const BinaryData& data) : parameters{data}
+    {
+    }
+
+    /**
+    @brief Creates a network with the data of a file
+    @param path The path of the file with the data
+    */
+    TiedNeuralNetwork(std::string path);
+
+    /**
+    @brief Export the network data to a file
+    @param path The path of the file where the data will be exported
+    */
+    void export_network(std::string path);
+
+    /**
+    @brief Apply the info of a given binary data
+    @param data The data to apply
+    */
+    void apply_binary_data(const BinaryData& data)
+    {
+        parameters = data;
+    }
+
+    /**
+    @brief Gets the binary data of the network
+    @return The binary data
+    */
+    const BinaryData& get_binary_data() const
+    {
+        return parameters;
+    }
+
+    /**
+    @brief Sets the learning rate of back_propagation. The gradients grow with the square of the input values,
+    so the rate must be smaller the larger the inputs are
+    @param rate The learning rate
+    */
+    void set_learning_rate(float rate)
+    {
+        learning_rate = rate;
+    }
+
+    /**
+    @brief Sets the precision of the activations of the compiled kernels. FAST is meant for the fitness
+    runs, the exported data does not depend on it
+    @param mode The precision mode
+    */
+    void set_math_mode(NNFastMath::modes mode)
+    {
+        math_mode = mode;
+    }
+
+    /**
+    @brief Gets the activation of the hidden layer
+    @return The activation type
+    */
+    NNActivations::activations get_hidden_activation() const
+    {
+        return hidden_activation;
+    }
+
+    /**
+    @brief Gets the activation of the output layer
+    @return The activation type
+    */
+    NNActivations::activations get_output_activation() const
+    {
+        return output_activation;
+    }
+
+    /**
+    @brief Compiles the network into its per pixel kernel
+    @return The kernel of the network
+    */
+    PixelKernel compile() const
+    {
+        return PixelKernel(parameters, hidden_activation, output_activation, math_mode);
+    }
+
+    /**
+    @brief Calculates the output of the network. The hidden values are not kept.
+    The amount of pixels is the one of the inputs, the outputs are resized to it
+    @param inputs The input values, three per pixel
+    @param outputs The collection where the output values will be stored
+    */
+    void feed_forward(const std::vector<float>& inputs, std::vector<float>& outputs) const;
+
+    /**
+    @brief Calculates the output of the network keeping the hidden values for a later back propagation.
+    The amount of pixels is the one of the inputs, so the colours of a ColorHistogram can be passed. The outputs
+    are resized to it
+    @param inputs The input values, three per pixel
+    @param outputs The collection where the output values will be stored
+    @param scratch The buffers where the hidden values are stored
+    */
+    void feed_forward(const std::vector<float>& inputs, std::vector<float>& outputs, Scratch& scratch) const;
+
+    /**
+    @brief Calculates the backpropagation: a gradient descent step of the tied weights with the mean of the
+    gradients of compute_gradients
+    @param inputs The input values of the feed_forward process
+    @param output The output values of the feed_forward process
+    @param desired The desired values
+    @param scratch The buffers filled by the feed_forward process
+    @param counts The amount of pixels each pixel stands for, as in a ColorHistogram. nullptr for one each
+    @return The gradients and the error before the step
+    */
+    Gradients back_propagation(const std::vector<float>& inputs, const std::vector<float>& output, const std::vector<float>& desired, const Scratch& scratch, const float* counts = nullptr);
+
+    /**
+    @brief Calculates the gradients of the squared error with respect to the tied weights, using the derivates
+    of the activations. The sums are reduced with a fixed tree, so they do not depend on the threads.
+    @param inputs The input values of the feed_forward process
+    @param output The output values of the feed_forward process
+    @param desired The desired values
+    @param scratch The buffers filled by the feed_forward process
+    @param counts The amount of pixels each pixel stands for, as in a ColorHistogram. nullptr for one each
+    @return The gradients and the error of the pass
+    */
+    Gradients compute_gradients(const std::vector<float>& inputs, const std::vector<float>& output, const std::vector<float>& desired, const Scratch& scratch, const float* counts = nullptr) const;
+
+private:
+
+    /**
+    @brief Gets a random weight in the same range used by the layers
+    @return The random weight
+    */
+    static float random_weight()
+    {
+        return NNRandom::get().next_float(-5.f, 5.f);
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <NNActivations.hpp>
+#include <NNFastMath.hpp>
+#include <Simd.hpp>
+
+/**
+@brief Vector versions of the activation policies, used by the kernels templated on them. Only the ones with the
+same results as the scalar functions are vectorized, the rest run one value at a time.
+*/
+template <class Activation>
+struct VectorActivation
+{
+    static constexpr bool vectorizable = false;
+};
+
+template <>
+struct VectorActivation<NNActivations::None>
+{
+    static constexpr bool vectorizable = true;
+
+    static __m128 sse2 (__m128 /*x*/) { return _mm_setzero_ps(); }
+    NN_TARGET_AVX2 static __m256 avx2 (__m256 /*x*/) { return _mm256_setzero_ps(); }
+};
+
+template <>
+struct VectorActivation<NNActivations::Relu>
+{
+    static constexpr bool vectorizable = true;
+
+    // 0 >= x is false for NaN, as in the scalar function
+    static __m128 sse2 (__m128 x)
+    {
+        return _mm_andnot_ps(_mm_cmple_ps(x, _mm_setzero_ps()), x);
+    }
+
+    NN_TARGET_AVX2 static __m256 avx2 (__m256 x)
+    {
+        return _mm256_andnot_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LE_OQ), x);
+    }
+};
+
+template <>
+struct VectorActivation<NNActivations::LeakyRelu>
+{
+    static constexpr bool vectorizable = true;
+
+    static __m128 sse2 (__m128 x)
+    {
+        __m128 mask = _mm_cmple_ps(x, _mm_setzero_ps());
+        return _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(_mm_set1_ps(0.01f), x)), _mm_andnot_ps(mask, x));
+    }
+
+    NN_TARGET_AVX2 static __m256 avx2 (__m256 x)
+    {
+        __m256 mask = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LE_OQ);
+        return _mm256_blendv_ps(x, _mm256_mul_ps(_mm256_set1_ps(0.01f), x), mask);
+    }
+};
+
+// The fast policies already run the same vector code on their scalar path
+
+template <>
+struct VectorActivation<NNFastMath::Sigmoid>
+{
+    static constexpr bool vectorizable = true;
+
+    static __m128 sse2 (__m128 x) { return NNFastMath::Sigmoid::sse2(x); }
+    NN_TARGET_AVX2 static __m256 avx2 (__m256 x) { return NNFastMath::Sigmoid::avx2(x); }
+};
+
+template <>
+struct VectorActivation<NNFastMath::Tanh>
+{
+    static constexpr bool vectorizable = true;
+
+    static __m128 sse2 (__m128 x) { return NNFastMath::Tanh::sse2(x); }
+    NN_TARGET_AVX2 static __m256 avx2 (__m256 x) { return NNFastMath::Tanh::avx2(x); }
+};
@@ -0,0 +1,155 @@
+#include <Checkpoint.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+/**
+@brief Starts writing a snapshot. Waits for the previous write first, so there is never more than one
+@param path The path of the snapshot
+@param payload The payload, moved to the writing thread
+*/
+void Checkpoint::save_async(const std::string& path, std::vector<uint8_t>&& payload)
+{
+    wait();
+
+    pending = std::async(std::launch::async, [path, payload = std::move(payload)]()
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        WriteResult result;
+        result.saved = write(path, payload);
+
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+        result.milliseconds = time.count();
+
+        return result;
+    });
+}
+
+/**
+@brief Waits for the write in progress, if any
+@return False if the last write failed
+*/
+bool Checkpoint::wait()
+{
+    if (!pending.valid())
+    {
+        return true;
+    }
+
+    const WriteResult result = pending.get();
+
+    last_write_milliseconds = result.milliseconds;
+
+    if (result.saved)
+    {
+        ++written;
+    }
+    else
+    {
+        ++failed;
+    }
+
+    return result.saved;
+}
+
+/**
+@brief Reads a snapshot and checks its header and hash
+@param path The path of the snapshot
+@param payload The payload read
+@return False if the file is missing, of another version or damaged
+*/
+bool Checkpoint::load(const std::string& path, std::vector<uint8_t>& payload)
+{
+    std::ifstream stream(path, std::ios::binary);
+
+    if (!stream)
+    {
+        return false;
+    }
+
+    uint32_t file_magic = 0;
+    uint32_t file_version = 0;
+    uint64_t size = 0;
+    uint64_t file_hash = 0;
+
+    stream.read(reinterpret_cast<char*>(&file_magic), sizeof(file_magic));
+    stream.read(reinterpret_cast<char*>(&file_version), sizeof(file_version));
+    stream.read(reinterpret_cast<char*>(&size), sizeof(size));
+    stream.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+
+    if (!stream || file_magic != magic || file_version != version)
+    {
+        return false;
+    }
+
+    // The size is checked against the file before allocating
+    const std::streamoff header_end = stream.tellg();
+    stream.seekg(0, std::ios::end);
+
+    if (uint64_t(stream.tellg() - header_end) != size)
+    {
+        return false;
+    }
+
+    stream.seekg(header_end);
+
+    payload.resize(size_t(size));
+    stream.read(reinterpret_cast<char*>(payload.data()), std::streamsize(size));
+
+    return bool(stream) && hash(payload) == file_hash;
+}
+
+/**
+@brief Writes a snapshot to a temporary file and replaces the previous one with it
+@param path The path of the snapshot
+@param payload The payload
+@return True if the snapshot was replaced
+*/
+bool Checkpoint::write(const std::string& path, const std::vector<uint8_t>& payload)
+{
+    const std::string temporary_path = path + ".tmp";
+
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+
+        const uint64_t size = payload.size();
+        const uint64_t payload_hash = hash(payload);
+
+        stream.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        stream.write(reinterpret_cast<const char*>(&payload_hash), sizeof(payload_hash));
+        stream.write(reinterpret_cast<const char*>(payload.data()), std::streamsize(payload.size()));
+        stream.flush();
+
+        if (!stream)
+        {
+            return false;
+        }
+    }
+
+    // The rename replaces the previous snapshot in one step, a reader sees either of them whole
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+
+    return !error;
+}
+
+/**
+@brief FNV-1a hash of a payload
+@param payload The payload
+@return The hash
+*/
+uint64_t Checkpoint::hash(const std::vector<uint8_t>& payload)
+{
+    uint64_t value = 0xCBF29CE484222325ull;
+
+    for (uint8_t byte : payload)
+    {
+        value ^= byte;
+        value *= 0x100000001B3ull;
+    }
+
+    return value;
+}
@@ -0,0 +1,362 @@
+#include <CmaEsOptimizer.hpp>
+#include <NNRandom.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+/**
+@brief Creates the optimizer. The spread of the population is the first step size
+@param population The first population, 6 weights per chromosome. Its size is the size of every ask
+*/
+CmaEsOptimizer::CmaEsOptimizer(const std::vector<float>& population) : population{population}
+{
+    const double n = double(genes);
+
+    samples = std::max<size_t>(2, population.size() / genes);
+    parents = samples / 2;
+
+    weights.resize(parents);
+
+    for (size_t i = 0; i < parents; ++i)
+    {
+        weights[i] = std::log(parents + 0.5) - std::log(i + 1.0);
+    }
+
+    const double weights_sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double squares_sum = 0.0;
+
+    for (double& weight : weights)
+    {
+        weight /= weights_sum;
+        squares_sum += weight * weight;
+    }
+
+    effective_parents = 1.0 / squares_sum;
+
+    sigma_learning_rate = (effective_parents + 2.0) / (n + effective_parents + 5.0);
+    sigma_damping = 1.0 + 2.0 * std::max(0.0, std::sqrt((effective_parents - 1.0) / (n + 1.0)) - 1.0) + sigma_learning_rate;
+    path_learning_rate = (4.0 + effective_parents / n) / (n + 4.0 + 2.0 * effective_parents / n);
+    rank_one_learning_rate = 2.0 / ((n + 1.3) * (n + 1.3) + effective_parents);
+    rank_parents_learning_rate = std::min(1.0 - rank_one_learning_rate, 2.0 * (effective_parents - 2.0 + 1.0 / effective_parents) / ((n + 2.0) * (n + 2.0) + effective_parents));
+    expected_norm = std::sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+    // The spread of the population is the first step size, the mean is set by the first tell
+    const size_t count = population.size() / genes;
+    double spread = 0.0;
+
+    for (size_t gene = 0; gene < genes; ++gene)
+    {
+        double sum = 0.0;
+        double square_sum = 0.0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            sum += population[i * genes + gene];
+            square_sum += double(population[i * genes + gene]) * population[i * genes + gene];
+        }
+
+        const double average = count > 0 ? sum / count : 0.0;
+        spread += count > 0 ? std::sqrt(std::max(0.0, square_sum / count - average * average)) : 0.0;
+
+        mean[gene] = 0.0;
+    }
+
+    sigma = spread > 0.0 ? spread / genes : 1.0;
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        covariance[i * genes + i] = 1.0;
+        basis[i * genes + i] = 1.0;
+        scales[i] = 1.0;
+    }
+}
+
+/**
+@brief Samples a generation around the mean, or gets the first population while it is not evaluated
+@param chromosomes Filled with 6 weights per chromosome
+*/
+void CmaEsOptimizer::ask(std::vector<float>& chromosomes)
+{
+    if (!population.empty())
+    {
+        chromosomes = population;
+        steps.clear();
+
+        return;
+    }
+
+    NNRandom& random = NNRandom::get();
+
+    steps.resize(samples);
+    chromosomes.resize(samples * genes);
+
+    for (size_t k = 0; k < samples; ++k)
+    {
+        Vector scaled;
+
+        for (size_t i = 0; i < genes; ++i)
+        {
+            scaled[i] = scales[i] * random.next_gaussian();
+        }
+
+        for (size_t i = 0; i < genes; ++i)
+        {
+            double step = 0.0;
+
+            for (size_t j = 0; j < genes; ++j)
+            {
+                step += basis[i * genes + j] * scaled[j];
+            }
+
+            steps[k][i] = step;
+            chromosomes[k * genes + i] = float(mean[i] + sigma * step);
+        }
+    }
+}
+
+/**
+@brief Moves the mean and adapts the covariance and the step size
+@param chromosomes The chromosomes of the last ask
+@param fitness The fitness of each chromosome
+*/
+void CmaEsOptimizer::update(const std::vector<float>& chromosomes, const std::vector<float>& fitness)
+{
+    // The first population only gives the mean
+    if (!population.empty())
+    {
+        const size_t best = std::min_element(fitness.begin(), fitness.end()) - fitness.begin();
+
+        for (size_t i = 0; i < genes && best < fitness.size(); ++i)
+        {
+            mean[i] = chromosomes[best * genes + i];
+        }
+
+        population.clear();
+        population.shrink_to_fit();
+
+        return;
+    }
+
+    const size_t count = std::min(fitness.size(), steps.size());
+
+    if (count < parents)
+    {
+        return;
+    }
+
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return fitness[a] < fitness[b]; });
+
+    // Weighted step of the best half
+    Vector mean_step {};
+
+    for (size_t k = 0; k < parents; ++k)
+    {
+        for (size_t i = 0; i < genes; ++i)
+        {
+            mean_step[i] += weights[k] * steps[order[k]][i];
+        }
+    }
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        mean[i] += sigma * mean_step[i];
+    }
+
+    // C^-1/2 * mean_step = B D^-1 B^T mean_step
+    Vector whitened {};
+
+    for (size_t j = 0; j < genes; ++j)
+    {
+        double projection = 0.0;
+
+        for (size_t i = 0; i < genes; ++i)
+        {
+            projection += basis[i * genes + j] * mean_step[i];
+        }
+
+        projection /= scales[j];
+
+        for (size_t i = 0; i < genes; ++i)
+        {
+            whitened[i] += basis[i * genes + j] * projection;
+        }
+    }
+
+    ++generation;
+
+    const double sigma_factor = std::sqrt(sigma_learning_rate * (2.0 - sigma_learning_rate) * effective_parents);
+    double sigma_path_norm = 0.0;
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        sigma_path[i] = (1.0 - sigma_learning_rate) * sigma_path[i] + sigma_factor * whitened[i];
+        sigma_path_norm += sigma_path[i] * sigma_path[i];
+    }
+
+    sigma_path_norm = std::sqrt(sigma_path_norm);
+
+    // The covariance path stalls while the step size grows fast
+    const double stall = std::sqrt(1.0 - std::pow(1.0 - sigma_learning_rate, 2.0 * generation));
+    const bool progressing = sigma_path_norm / stall < (1.4 + 2.0 / (genes + 1.0)) * expected_norm;
+    const double path_factor = progressing ? std::sqrt(path_learning_rate * (2.0 - path_learning_rate) * effective_parents) : 0.0;
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        covariance_path[i] = (1.0 - path_learning_rate) * covariance_path[i] + path_factor * mean_step[i];
+    }
+
+    const double correction = progressing ? 0.0 : path_learning_rate * (2.0 - path_learning_rate);
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        for (size_t j = 0; j < genes; ++j)
+        {
+            double rank_parents = 0.0;
+
+            for (size_t k = 0; k < parents; ++k)
+            {
+                rank_parents += weights[k] * steps[order[k]][i] * steps[order[k]][j];
+            }
+
+            double& value = covariance[i * genes + j];
+
+            value = (1.0 - rank_one_learning_rate - rank_parents_learning_rate) * value
+                  + rank_one_learning_rate * (covariance_path[i] * covariance_path[j] + correction * value)
+                  + rank_parents_learning_rate * rank_parents;
+        }
+    }
+
+    sigma *= std::exp((sigma_learning_rate / sigma_damping) * (sigma_path_norm / expected_norm - 1.0));
+
+    decompose();
+}
+
+/**
+@brief Decomposes the covariance in basis and scales
+*/
+void CmaEsOptimizer::decompose()
+{
+    Matrix a = covariance;
+    Matrix vectors {};
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        vectors[i * genes + i] = 1.0;
+    }
+
+    // Cyclic Jacobi rotations
+    for (int sweep = 0; sweep < 50; ++sweep)
+    {
+        double off = 0.0;
+        double diagonal = 0.0;
+
+        for (size_t p = 0; p < genes; ++p)
+        {
+            diagonal += a[p * genes + p] * a[p * genes + p];
+
+            for (size_t q = p + 1; q < genes; ++q)
+            {
+                off += a[p * genes + q] * a[p * genes + q];
+            }
+        }
+
+        if (off <= 1e-30 * diagonal)
+        {
+            break;
+        }
+
+        for (size_t p = 0; p + 1 < genes; ++p)
+        {
+            for (size_t q = p + 1; q < genes; ++q)
+            {
+                const double apq = a[p * genes + q];
+
+                if (apq == 0.0)
+                {
+                    continue;
+                }
+
+                const double theta = (a[q * genes + q] - a[p * genes + p]) / (2.0 * apq);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+
+                for (size_t k = 0; k < genes; ++k)
+                {
+                    const double akp = a[k * genes + p];
+                    const double akq = a[k * genes + q];
+
+                    a[k * genes + p] = c * akp - s * akq;
+                    a[k * genes + q] = s * akp + c * akq;
+                }
+
+                for (size_t k = 0; k < genes; ++k)
+                {
+                    const double apk = a[p * genes + k];
+                    const double aqk = a[q * genes + k];
+
+                    a[p * genes + k] = c * apk - s * aqk;
+                    a[q * genes + k] = s * apk + c * aqk;
+                }
+
+                for (size_t k = 0; k < genes; ++k)
+                {
+                    const double vkp = vectors[k * genes + p];
+                    const double vkq = vectors[k * genes + q];
+
+                    vectors[k * genes + p] = c * vkp - s * vkq;
+                    vectors[k * genes + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    basis = vectors;
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        scales[i] = std::sqrt(std::max(a[i * genes + i], 1e-20));
+    }
+}
+
+/**
+@brief Writes the distribution, the evolution paths and the first population while it is not evaluated. The
+steps of the last ask are not needed between a tell and the next ask
+@param writer The payload of the checkpoint
+*/
+void CmaEsOptimizer::save_state(CheckpointWriter& writer) const
+{
+    writer.write(mean);
+    writer.write(sigma);
+    writer.write(covariance);
+    writer.write(basis);
+    writer.write(scales);
+    writer.write(sigma_path);
+    writer.write(covariance_path);
+    writer.write(generation);
+    writer.write_vector(population);
+}
+
+/**
+@brief Restores the distribution, the evolution paths and the first population
+@param reader The payload of the checkpoint
+@return False if the payload does not hold the state
+*/
+bool CmaEsOptimizer::load_state(CheckpointReader& reader)
+{
+    reader.read(mean);
+    reader.read(sigma);
+    reader.read(covariance);
+    reader.read(basis);
+    reader.read(scales);
+    reader.read(sigma_path);
+    reader.read(covariance_path);
+    reader.read(generation);
+    reader.read_vector(population);
+
+    steps.clear();
+
+    return reader.is_valid();
+}
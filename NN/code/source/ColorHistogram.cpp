@@ -0,0 +1,80 @@
+#include <ColorHistogram.hpp>
+#include <array>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    typedef std::array<uint32_t, 6> Color;  //< Bits of the input and desired values of a pixel
+
+    struct ColorHash
+    {
+        size_t operator () (const Color& color) const
+        {
+            uint64_t hash = 0x9E3779B97F4A7C15ull;
+
+            for (uint32_t value : color)
+            {
+                hash ^= value;
+                hash *= 0xBF58476D1CE4E5B9ull;
+                hash ^= hash >> 31;
+            }
+
+            return size_t(hash);
+        }
+    };
+}
+
+/**
+@brief Builds the table of an image
+@param image_input The input values of the image, three per pixel
+@param image_desired The desired values of the image, three per pixel
+*/
+void ColorHistogram::build(const std::vector<float>& image_input, const std::vector<float>& image_desired)
+{
+    build(image_input.data(), image_desired.data(), image_input.size() / 3);
+}
+
+/**
+@brief Builds the table of an image read in place, as the planes of the dataset cache
+@param image_input The input values of the image, three per pixel
+@param image_desired The desired values of the image, three per pixel
+@param pixels_count The amount of pixels
+*/
+void ColorHistogram::build(const float* image_input, const float* image_desired, size_t pixels_count)
+{
+    pixels = pixels_count;
+
+    input.clear();
+    desired.clear();
+    counts.clear();
+
+    std::unordered_map<Color, size_t, ColorHash> indexes;
+    indexes.reserve(pixels / 4);
+
+    // A float count stops increasing at 2^24, the weights are made once the pixels are counted
+    std::vector<uint64_t> pixel_counts;
+
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        const float* pixel_input = image_input + i * 3;
+        const float* pixel_desired = image_desired + i * 3;
+
+        Color color;
+        std::memcpy(color.data(), pixel_input, sizeof(float) * 3);
+        std::memcpy(color.data() + 3, pixel_desired, sizeof(float) * 3);
+
+        auto found = indexes.emplace(color, pixel_counts.size());
+
+        if (found.second)
+        {
+            input.insert(input.end(), pixel_input, pixel_input + 3);
+            desired.insert(desired.end(), pixel_desired, pixel_desired + 3);
+            pixel_counts.push_back(0);
+        }
+
+        ++pixel_counts[found.first->second];
+    }
+
+    counts.assign(pixel_counts.begin(), pixel_counts.end());
+}
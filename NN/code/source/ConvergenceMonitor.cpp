@@ -0,0 +1,170 @@
+#include <ConvergenceMonitor.hpp>
+#include <cmath>
+#include <numeric>
+
+/**
+@brief Gets the name of a reason to stop
+@param reason The reason
+@return The name
+*/
+const char* ConvergenceMonitor::get_reason_name(reasons reason)
+{
+    switch (reason)
+    {
+        case STALLED:
+
+            return "stalled";
+
+        case TARGET_REACHED:
+
+            return "target reached";
+
+        case STEP_LIMIT:
+
+            return "step limit";
+
+        default:
+
+            return "running";
+    }
+}
+
+/**
+@brief Starts a new run
+*/
+void ConvergenceMonitor::reset()
+{
+    best_history.clear();
+    mean_history.clear();
+    steps = 0;
+    stalled = 0;
+    stop = Stop();
+}
+
+/**
+@brief Adds the fitness of a step and checks if the run stops
+@param best The best fitness of the step, lower is better
+@param mean The mean fitness of the step
+@return True if the run stops with this step
+*/
+bool ConvergenceMonitor::update(float best, float mean)
+{
+    if (has_stopped())
+    {
+        return true;
+    }
+
+    ++steps;
+
+    // Only the last two windows are kept
+    const size_t length = size_t(settings.window) * 2;
+
+    if (best_history.size() == length)
+    {
+        best_history.erase(best_history.begin());
+        mean_history.erase(mean_history.begin());
+    }
+
+    best_history.push_back(best);
+    mean_history.push_back(mean);
+
+    stop.step = steps;
+    stop.best = best;
+
+    if (best <= settings.target)
+    {
+        stop.reason = TARGET_REACHED;
+        return true;
+    }
+
+    if (best_history.size() < length)
+    {
+        return false;
+    }
+
+    stop.best_improvement = get_improvement(best_history);
+    stop.mean_improvement = get_improvement(mean_history);
+
+    if (stop.best_improvement < settings.minimum_improvement && stop.mean_improvement < settings.minimum_improvement)
+    {
+        ++stalled;
+    }
+    else
+    {
+        stalled = 0;
+    }
+
+    if (settings.patience > 0 && stalled >= settings.patience)
+    {
+        stop.reason = STALLED;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+@brief Records that the run ended by itself, after every step it had
+*/
+void ConvergenceMonitor::finish()
+{
+    if (!has_stopped())
+    {
+        stop.reason = STEP_LIMIT;
+    }
+}
+
+/**
+@brief Writes the state of the run to a checkpoint
+@param writer The payload of the checkpoint
+*/
+void ConvergenceMonitor::save(CheckpointWriter& writer) const
+{
+    writer.write_vector(best_history);
+    writer.write_vector(mean_history);
+    writer.write(steps);
+    writer.write(stalled);
+    writer.write(stop);
+}
+
+/**
+@brief Restores the state written by save
+@param reader The payload of the checkpoint
+@return False if the payload does not hold the state
+*/
+bool ConvergenceMonitor::load(CheckpointReader& reader)
+{
+    reader.read_vector(best_history);
+    reader.read_vector(mean_history);
+    reader.read(steps);
+    reader.read(stalled);
+    reader.read(stop);
+
+    if (!reader.is_valid() || best_history.size() != mean_history.size() || best_history.size() > size_t(settings.window) * 2)
+    {
+        reset();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+@brief Gets the relative improvement of the average of the last window of a history over the window before
+@param history The last two windows of a fitness
+@return The improvement, positive when the fitness went down
+*/
+float ConvergenceMonitor::get_improvement(const std::vector<float>& history) const
+{
+    const size_t window = settings.window;
+
+    const double previous = std::accumulate(history.begin(), history.begin() + window, 0.0) / window;
+    const double last = std::accumulate(history.begin() + window, history.end(), 0.0) / window;
+
+    if (!std::isfinite(previous) || !std::isfinite(last))
+    {
+        return 1.f;
+    }
+
+    return previous != 0.0 ? float((previous - last) / std::fabs(previous)) : 0.f;
+}
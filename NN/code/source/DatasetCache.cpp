@@ -0,0 +1,381 @@
+#include <DatasetCache.hpp>
+#include <Image.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+/**
+@brief Writes the file of the images 0.png, 1.png... of a folder, as many as there are. The images run on
+every thread of the pool, and the planes of an image whose PNG has the hash it had in the previous file are
+copied from it instead of decoded again. The file is written next to its path and renamed once complete
+@param folder The folder of the images, ending with a separator
+@param path The path of the file
+@param decoded The amount of images decoded
+@return The amount of images, 0 if the file could not be written
+*/
+uint32_t DatasetCache::compile(const std::string& folder, const std::string& path, uint32_t& decoded)
+{
+    uint32_t images = 0;
+    decoded = 0;
+
+    while (std::filesystem::exists(get_image_path(folder, images)))
+    {
+        ++images;
+    }
+
+    if (images == 0)
+    {
+        return 0;
+    }
+
+    // The planes of the images that did not change are copied from it
+    DatasetCache previous;
+    previous.open(path);
+
+    const std::string temporary_path = path + ".tmp";
+    bool written = false;
+
+    {
+        std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+
+        const Header header = {magic, version, images, 0};
+        std::vector<Entry> index(images, Entry{});
+
+        // The index is written again once the offsets are known
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        stream.write(reinterpret_cast<const char*>(index.data()), std::streamsize(index.size() * sizeof(Entry)));
+
+        static const char padding[alignment] = {};
+
+        uint64_t offset = sizeof(Header) + index.size() * sizeof(Entry);
+        stream.write(padding, std::streamsize(align(offset) - offset));
+        offset = align(offset);
+
+        // A round of one image per thread, the planes are written in the order of the images
+        ThreadPool& pool = ThreadPool::get();
+        const uint32_t round_images = uint32_t(pool.get_threads_count());
+
+        std::vector<std::vector<uint8_t>> planes(round_images);
+        std::vector<uint8_t> valid(round_images);
+        std::vector<uint8_t> reused(round_images);
+
+        for (uint32_t first = 0; first < images && stream; first += round_images)
+        {
+            const uint32_t round = std::min(round_images, images - first);
+
+            pool.run(round, [&](size_t k)
+            {
+                const uint32_t i = first + uint32_t(k);
+                const std::string image_path = get_image_path(folder, i);
+
+                Entry& entry = index[i];
+
+                std::error_code error;
+                entry.source_size = std::filesystem::file_size(image_path, error);
+                entry.source_time = error ? 0 : std::filesystem::last_write_time(image_path, error).time_since_epoch().count();
+
+                valid[k] = !error && hash_file(image_path, entry.source_hash);
+                reused[k] = valid[k] && i < previous.get_count() && previous.entries[i].source_hash == entry.source_hash && previous.entries[i].source_size == entry.source_size;
+
+                if (reused[k])
+                {
+                    entry.width = previous.entries[i].width;
+                    entry.height = previous.entries[i].height;
+                }
+                else if (valid[k])
+                {
+                    decode_image(image_path, entry, planes[k]);
+                }
+            });
+
+            for (uint32_t k = 0; k < round && stream; ++k)
+            {
+                Entry& entry = index[first + k];
+
+                if (!valid[k])
+                {
+                    stream.setstate(std::ios::failbit);
+                    break;
+                }
+
+                const uint64_t planes_size = get_planes_size(uint64_t(entry.width) * entry.height);
+                const uint8_t* source = reused[k] ? previous.data + previous.entries[first + k].rgb_offset : planes[k].data();
+
+                stream.write(reinterpret_cast<const char*>(source), std::streamsize(planes_size));
+
+                set_offsets(entry, offset);
+                offset += planes_size;
+
+                decoded += reused[k] ? 0 : 1;
+            }
+        }
+
+        stream.seekp(sizeof(Header));
+        stream.write(reinterpret_cast<const char*>(index.data()), std::streamsize(index.size() * sizeof(Entry)));
+        stream.flush();
+
+        written = bool(stream);
+    }
+
+    // A mapped file can not be replaced on every system
+    previous.close();
+
+    if (!written)
+    {
+        std::filesystem::remove(temporary_path);
+        return 0;
+    }
+
+    // The rename replaces the previous file in one step, a trainer maps either of them whole
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+
+    return error ? 0 : images;
+}
+
+/**
+@brief Checks if a file holds every image of a folder as it is now, from its index and the PNG files only
+@param folder The folder of the images, ending with a separator
+@param path The path of the file
+@return False if the file is missing, of another version or the images changed
+*/
+bool DatasetCache::is_current(const std::string& folder, const std::string& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+
+    Header header = {};
+    stream.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+    if (!stream || header.magic != magic || header.version != version || header.count == 0)
+    {
+        return false;
+    }
+
+    std::vector<Entry> index(header.count);
+    stream.read(reinterpret_cast<char*>(index.data()), std::streamsize(index.size() * sizeof(Entry)));
+
+    if (!stream)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        const std::string image_path = get_image_path(folder, i);
+
+        std::error_code error;
+        const uint64_t source_size = std::filesystem::file_size(image_path, error);
+
+        if (error || source_size != index[i].source_size)
+        {
+            return false;
+        }
+
+        const int64_t source_time = std::filesystem::last_write_time(image_path, error).time_since_epoch().count();
+
+        if (error || source_time != index[i].source_time)
+        {
+            return false;
+        }
+    }
+
+    // An image added after the last one
+    return !std::filesystem::exists(get_image_path(folder, header.count));
+}
+
+/**
+@brief Maps a file in memory
+@param path The path of the file
+@return False if the file is missing, of another version or damaged
+*/
+bool DatasetCache::open(const std::string& path)
+{
+    close();
+
+    file.setFileName(QString::fromStdString(path));
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    size = uint64_t(file.size());
+    data = size >= sizeof(Header) ? file.map(0, qint64(size)) : nullptr;
+
+    if (data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+
+    if (header->magic != magic || header->version != version || size < sizeof(Header) + uint64_t(header->count) * sizeof(Entry))
+    {
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const Entry*>(data + sizeof(Header));
+    count = header->count;
+
+    // Every plane must be inside the file, where compile places it
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Entry expected = entries[i];
+        set_offsets(expected, entries[i].rgb_offset);
+
+        if (entries[i].rgb_offset % alignment != 0 || entries[i].rgb_offset + get_planes_size(get_pixels_count(i)) > size ||
+            std::memcmp(&expected, &entries[i], sizeof(Entry)) != 0)
+        {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+@brief Unmaps the file, the planes given before are no longer valid
+*/
+void DatasetCache::close()
+{
+    if (data != nullptr)
+    {
+        file.unmap(const_cast<uint8_t*>(data));
+    }
+
+    if (file.isOpen())
+    {
+        file.close();
+    }
+
+    data = nullptr;
+    size = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+/**
+@brief Sets the offsets of the planes of an image
+@param entry The entry of the image, with its size
+@param offset The offset of the first plane
+*/
+void DatasetCache::set_offsets(Entry& entry, uint64_t offset)
+{
+    const uint64_t pixels = uint64_t(entry.width) * entry.height;
+    const uint64_t float_plane_size = align(pixels * 3 * sizeof(float));
+
+    entry.rgb_offset = offset;
+    entry.luv_offset = offset + align(pixels * 3);
+
+    for (uint32_t target = 0; target < targets_count; ++target)
+    {
+        entry.target_offsets[target] = entry.luv_offset + float_plane_size * (1 + target);
+    }
+}
+
+/**
+@brief Decodes an image and computes its planes
+@param image_path The path of the PNG
+@param entry The entry of the image, its offsets are relative to the planes
+@param planes The planes
+*/
+void DatasetCache::decode_image(const std::string& image_path, Entry& entry, std::vector<uint8_t>& planes)
+{
+    Image img(image_path);
+    const size_t pixels = size_t(img.get_width()) * img.get_height();
+
+    entry.width = img.get_width();
+    entry.height = img.get_height();
+    set_offsets(entry, 0);
+
+    planes.assign(get_planes_size(pixels), 0);
+
+    uint8_t* rgb = planes.data() + entry.rgb_offset;
+    float* luv = reinterpret_cast<float*>(planes.data() + entry.luv_offset);
+    float* target_planes[targets_count];
+
+    for (uint32_t target = 0; target < targets_count; ++target)
+    {
+        target_planes[target] = reinterpret_cast<float*>(planes.data() + entry.target_offsets[target]);
+    }
+
+    auto write_rgb = [](float* plane, size_t p, const Pixel& pixel)
+    {
+        plane[p * 3]     = pixel.rgb_components.red;
+        plane[p * 3 + 1] = pixel.rgb_components.green;
+        plane[p * 3 + 2] = pixel.rgb_components.blue;
+    };
+
+    // The same conversions as extract_input_from_image, lms_daltonization and rgb_daltonization, the PNG values
+    // are multiples of 1 / 255
+    for (size_t p = 0; p < pixels; ++p)
+    {
+        Pixel pixel = img.get_pixels()[p];
+
+        rgb[p * 3]     = uint8_t(std::lround(pixel.rgb_components.red * 255.f));
+        rgb[p * 3 + 1] = uint8_t(std::lround(pixel.rgb_components.green * 255.f));
+        rgb[p * 3 + 2] = uint8_t(std::lround(pixel.rgb_components.blue * 255.f));
+
+        Pixel target = pixel;
+        target.lms_deuteranopia();
+        write_rgb(target_planes[LMS_DEUTERANOPIA], p, target);
+
+        target = pixel;
+        target.lms_protanopia();
+        write_rgb(target_planes[LMS_PROTANOPIA], p, target);
+
+        target = pixel;
+        target.lms_tritanopia();
+        write_rgb(target_planes[LMS_TRITANOPIA], p, target);
+
+        target = pixel;
+        target.rgb_daltonization();
+        write_rgb(target_planes[RGB_DALTONIZATION], p, target);
+
+        pixel.convert_rgb_to_luv();
+
+        luv[p * 3]     = pixel.luv_components.l;
+        luv[p * 3 + 1] = pixel.luv_components.u;
+        luv[p * 3 + 2] = pixel.luv_components.v;
+    }
+}
+
+/**
+@brief FNV-1a hash of a file
+@param path The path of the file
+@param hash The hash
+@return False if the file can not be read
+*/
+bool DatasetCache::hash_file(const std::string& path, uint64_t& hash)
+{
+    std::ifstream stream(path, std::ios::binary);
+
+    if (!stream)
+    {
+        return false;
+    }
+
+    hash = 0xCBF29CE484222325ull;
+
+    std::vector<char> buffer(1 << 16);
+
+    while (stream)
+    {
+        stream.read(buffer.data(), std::streamsize(buffer.size()));
+
+        for (std::streamsize i = 0; i < stream.gcount(); ++i)
+        {
+            hash ^= uint8_t(buffer[size_t(i)]);
+            hash *= 0x100000001B3ull;
+        }
+    }
+
+    return stream.eof();
+}
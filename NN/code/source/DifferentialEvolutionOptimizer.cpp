@@ -0,0 +1,131 @@
+#include <DifferentialEvolutionOptimizer.hpp>
+#include <NNRandom.hpp>
+#include <algorithm>
+
+/**
+@brief Gets the trials of the population, or the population itself when its fitness is unknown
+@param chromosomes Filled with 6 weights per chromosome
+*/
+void DifferentialEvolutionOptimizer::ask(std::vector<float>& chromosomes)
+{
+    chromosomes = population;
+
+    if (!evaluated)
+    {
+        return;
+    }
+
+    // The targets follow the trials
+    if (rescoring)
+    {
+        chromosomes.insert(chromosomes.end(), population.begin(), population.end());
+    }
+
+    NNRandom& random = NNRandom::get();
+    const size_t count = population.size() / genes;
+
+    // Three other chromosomes, distinct when the population is large enough
+    auto pick = [&](size_t target, size_t first, size_t second)
+    {
+        size_t index;
+
+        do
+        {
+            index = random.next() % count;
+        }
+        while (count >= 4 && (index == target || index == first || index == second));
+
+        return index;
+    };
+
+    for (size_t target = 0; target < count; ++target)
+    {
+        const size_t base = pick(target, target, target);
+        const size_t first = pick(target, base, base);
+        const size_t second = pick(target, base, first);
+        const size_t forced_gene = random.next() % genes;
+
+        for (size_t gene = 0; gene < genes; ++gene)
+        {
+            if (gene == forced_gene || random.next_float() < crossover_probability)
+            {
+                chromosomes[target * genes + gene] = population[base * genes + gene] +
+                                                     differential_weight * (population[first * genes + gene] - population[second * genes + gene]);
+            }
+        }
+    }
+}
+
+/**
+@brief Replaces the chromosomes whose trial is not worse
+@param chromosomes The chromosomes of the last ask
+@param fitness The fitness of each chromosome
+*/
+void DifferentialEvolutionOptimizer::update(const std::vector<float>& chromosomes, const std::vector<float>& fitness)
+{
+    if (!evaluated)
+    {
+        population = chromosomes;
+        population_fitness = fitness;
+        evaluated = true;
+
+        return;
+    }
+
+    const size_t count = population.size() / genes;
+
+    // The targets scored on this batch. They may have been replaced, by migrants or by polished chromosomes
+    if (rescoring && fitness.size() == count * 2)
+    {
+        std::copy(chromosomes.begin() + count * genes, chromosomes.end(), population.begin());
+        std::copy(fitness.begin() + count, fitness.end(), population_fitness.begin());
+    }
+
+    for (size_t target = 0; target < count; ++target)
+    {
+        // A trial screened out is not compared with a target screened out
+        if (fitness[target] <= population_fitness[target] && fitness[target] < std::numeric_limits<float>::max())
+        {
+            std::copy(chromosomes.begin() + target * genes, chromosomes.begin() + (target + 1) * genes, population.begin() + target * genes);
+            population_fitness[target] = fitness[target];
+        }
+    }
+}
+
+/**
+@brief Writes the population and its fitness
+@param writer The payload of the checkpoint
+*/
+void DifferentialEvolutionOptimizer::save_state(CheckpointWriter& writer) const
+{
+    writer.write_vector(population);
+    writer.write_vector(population_fitness);
+    writer.write(evaluated);
+}
+
+/**
+@brief Restores the population and its fitness
+@param reader The payload of the checkpoint
+@return False if the payload does not hold a population of the same size
+*/
+bool DifferentialEvolutionOptimizer::load_state(CheckpointReader& reader)
+{
+    std::vector<float> saved_population;
+    std::vector<float> saved_fitness;
+    bool saved_evaluated = false;
+
+    reader.read_vector(saved_population);
+    reader.read_vector(saved_fitness);
+    reader.read(saved_evaluated);
+
+    if (!reader.is_valid() || saved_population.size() != population.size())
+    {
+        return false;
+    }
+
+    population = std::move(saved_population);
+    population_fitness = std::move(saved_fitness);
+    evaluated = saved_evaluated;
+
+    return true;
+}
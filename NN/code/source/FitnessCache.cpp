@@ -0,0 +1,170 @@
+#include <FitnessCache.hpp>
+#include <cstring>
+
+/**
+@brief Mixes the bits of the key, a multiply and xor-shift per word
+@param key The key
+@return The hash
+*/
+size_t FitnessCache::KeyHash::operator () (const Key& key) const
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+
+    auto mix = [&](uint32_t value)
+    {
+        hash ^= value;
+        hash *= 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 31;
+    };
+
+    for (uint32_t weight : key.weights)
+    {
+        mix(weight);
+    }
+
+    mix(key.dataset);
+    mix(key.evaluation);
+
+    return size_t(hash);
+}
+
+/**
+@brief Creates a key
+@param chromosome The 6 weights of the chromosome
+@param dataset The image the fitness is measured on
+@param evaluation The evaluation and impairment that give the desired values
+@return The key
+*/
+FitnessCache::Key FitnessCache::make_key(const float* chromosome, uint32_t dataset, uint32_t evaluation)
+{
+    Key key;
+
+    std::memcpy(key.weights.data(), chromosome, sizeof(float) * genes);
+    key.dataset = dataset;
+    key.evaluation = evaluation;
+
+    return key;
+}
+
+/**
+@brief Looks up the fitness of a population. The fitness of the chromosomes in the table is written and the
+distinct chromosomes missing are copied to pending, to be evaluated and passed to store
+@param chromosomes The first weight of the matrix. 6 weights per candidate
+@param candidates The amount of candidates
+@param dataset The image the fitness is measured on
+@param evaluation The evaluation and impairment that give the desired values
+@param fitness The first fitness. One per candidate, only the hits are written
+@param pending The chromosomes to evaluate, 6 weights per chromosome
+@return The amount of chromosomes to evaluate
+*/
+size_t FitnessCache::lookup(const float* chromosomes, size_t candidates, uint32_t dataset, uint32_t evaluation, float* fitness, std::vector<float>& pending)
+{
+    pending_slots.clear();
+    pending_keys.clear();
+    pending_candidates.clear();
+    pending.clear();
+
+    for (size_t candidate = 0; candidate < candidates; ++candidate)
+    {
+        const float* chromosome = chromosomes + candidate * genes;
+        const Key key = make_key(chromosome, dataset, evaluation);
+
+        ++lookups;
+
+        auto found = table.find(key);
+
+        if (found != table.end())
+        {
+            fitness[candidate] = found->second;
+            ++hits;
+            continue;
+        }
+
+        // A copy of a chromosome already pending is evaluated once
+        auto slot = pending_slots.emplace(key, pending_keys.size());
+
+        if (slot.second)
+        {
+            pending_keys.push_back(key);
+            pending.insert(pending.end(), chromosome, chromosome + genes);
+        }
+        else
+        {
+            ++hits;
+        }
+
+        pending_candidates.emplace_back(candidate, slot.first->second);
+    }
+
+    return pending_keys.size();
+}
+
+/**
+@brief Adds the fitness of the chromosomes given by the last lookup to the table and writes the fitness of
+every candidate that missed
+@param pending_fitness The fitness of the pending chromosomes, in the order of the lookup
+@param pending_complete 1 for the fitness values to store, 0 for partial values that are only written
+@param fitness The first fitness of the candidates of the last lookup
+*/
+void FitnessCache::store(const float* pending_fitness, const uint8_t* pending_complete, float* fitness)
+{
+    for (size_t slot = 0; slot < pending_keys.size(); ++slot)
+    {
+        if (pending_complete[slot])
+        {
+            table.emplace(pending_keys[slot], pending_fitness[slot]);
+        }
+    }
+
+    for (const auto& candidate : pending_candidates)
+    {
+        fitness[candidate.first] = pending_fitness[candidate.second];
+    }
+
+    pending_slots.clear();
+    pending_keys.clear();
+    pending_candidates.clear();
+}
+
+/**
+@brief Writes the fitness values stored to a checkpoint, so a resumed run evaluates the chromosomes the run
+would have evaluated
+@param writer The payload of the checkpoint
+*/
+void FitnessCache::save(CheckpointWriter& writer) const
+{
+    std::vector<Entry> entries;
+    entries.reserve(table.size());
+
+    for (const auto& entry : table)
+    {
+        entries.push_back({entry.first, entry.second});
+    }
+
+    writer.write_vector(entries);
+}
+
+/**
+@brief Replaces the fitness values stored with the ones written by save
+@param reader The payload of the checkpoint
+@return False if the payload does not hold the values
+*/
+bool FitnessCache::load(CheckpointReader& reader)
+{
+    std::vector<Entry> entries;
+
+    if (!reader.read_vector(entries))
+    {
+        return false;
+    }
+
+    table.clear();
+    table.reserve(entries.size());
+
+    for (const Entry& entry : entries)
+    {
+        table.emplace(entry.key, entry.fitness);
+    }
+
+    return true;
+}
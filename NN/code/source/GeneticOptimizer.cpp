@@ -0,0 +1,72 @@
+#include <GeneticOptimizer.hpp>
+#include <NNRandom.hpp>
+#include <algorithm>
+
+/**
+@brief Recombines the population from its two best chromosomes
+@param chromosomes The chromosomes of the last ask
+@param fitness The fitness of each chromosome
+*/
+void GeneticOptimizer::update(const std::vector<float>& chromosomes, const std::vector<float>& fitness)
+{
+    size_t best_parent_index = 0;
+    size_t second_best_parent_index = 0;
+
+    float best_delta = std::numeric_limits<float>::max();
+    float second_best_delta = std::numeric_limits<float>::max();
+
+    for (size_t index = 0; index < fitness.size(); ++index)
+    {
+        float delta = fitness[index];
+
+        if (delta < best_delta)
+        {
+            second_best_parent_index = best_parent_index;
+            second_best_delta = best_delta;
+
+            best_parent_index = index;
+            best_delta = delta;
+        }
+        else if (delta < second_best_delta)
+        {
+            second_best_parent_index = index;
+            second_best_delta = delta;
+        }
+    }
+
+    std::array<float, genes> parent_1;
+    std::array<float, genes> parent_2;
+
+    std::copy(chromosomes.begin() + best_parent_index * genes, chromosomes.begin() + (best_parent_index + 1) * genes, parent_1.begin());
+    std::copy(chromosomes.begin() + second_best_parent_index * genes, chromosomes.begin() + (second_best_parent_index + 1) * genes, parent_2.begin());
+
+    population.resize(chromosomes.size());
+
+    // Every chromosome is replaced, the parents included
+    for (size_t index = 0; index < fitness.size(); ++index)
+    {
+        for (size_t gene = 0; gene < genes; ++gene)
+        {
+            population[index * genes + gene] = recombine_weight(parent_1[gene], parent_2[gene]);
+        }
+    }
+}
+
+/**
+@brief Recombine the given weights and mutate if needed
+@param parent_1_value The value of the first parent
+@param parent_2_value The value of the second parent
+@return The new value
+*/
+float GeneticOptimizer::recombine_weight(float parent_1_value, float parent_2_value)
+{
+    const float parent_1_prob = 0.45f;
+    const float parent_2_prob = 0.45f;
+
+    NNRandom& random = NNRandom::get();
+    float action = random.next_float();
+
+    return action < parent_1_prob                 ? parent_1_value :
+           action < parent_1_prob + parent_2_prob ? parent_2_value :
+                                                    random.next_float(-5.f, 5.f);
+}
@@ -0,0 +1,146 @@
+#include <GradientTrainer.hpp>
+#include <cmath>
+
+/**
+@brief Creates a trainer for a network
+@param network The network to train. The trainer changes its weights on every update
+@param settings The optimizer, schedule and batch settings
+*/
+GradientTrainer::GradientTrainer(TiedNeuralNetwork& network, const Settings& settings)
+    :
+    network {network},
+    settings {settings}
+{
+    const BinaryData& data = network.get_binary_data();
+
+    parameters = {data.wa, data.wb, data.wc, data.wd, data.we, data.wf};
+}
+
+/**
+@brief Runs an image through the network and adds its gradients to the current batch
+@param inputs The input values, three per pixel
+@param desired The desired values, three per pixel
+@return The mean error per pixel of the image before the update
+*/
+double GradientTrainer::accumulate(const std::vector<float>& inputs, const std::vector<float>& desired)
+{
+    outputs.resize(inputs.size());
+    network.feed_forward(inputs, outputs, scratch);
+
+    return add_gradients(network.compute_gradients(inputs, outputs, desired, scratch));
+}
+
+/**
+@brief Runs the colour table of an image through the network and adds its gradients, weighted by the amount
+of pixels of each colour, to the current batch. Same gradients as the whole image
+@param histogram The colour table of the image
+@return The mean error per pixel of the image before the update
+*/
+double GradientTrainer::accumulate(const ColorHistogram& histogram)
+{
+    outputs.resize(histogram.get_input().size());
+    network.feed_forward(histogram.get_input(), outputs, scratch);
+
+    return add_gradients(network.compute_gradients(histogram.get_input(), outputs, histogram.get_desired(), scratch, histogram.get_counts().data()));
+}
+
+/**
+@brief Adds the gradients of an image to the current batch
+@param image The gradients of the image
+@return The mean error per pixel of the image
+*/
+double GradientTrainer::add_gradients(const TiedNeuralNetwork::Gradients& image)
+{
+    for (size_t k = 0; k < gradients.size(); ++k)
+    {
+        gradients[k] += image.weights[k];
+    }
+
+    batch_error += image.error;
+    batch_pixels += image.pixels;
+    ++batch_images;
+
+    return image.pixels > 0 ? image.error / image.pixels : 0.0;
+}
+
+/**
+@brief Updates the weights of the network with the mean gradient of the batch and starts a new batch
+@return The mean error per pixel of the batch
+*/
+double GradientTrainer::step()
+{
+    if (batch_pixels == 0)
+    {
+        return 0.0;
+    }
+
+    const double learning_rate = get_learning_rate();
+    ++steps;
+
+    for (size_t k = 0; k < parameters.size(); ++k)
+    {
+        const double gradient = gradients[k] / batch_pixels;
+
+        if (settings.optimizer == ADAM)
+        {
+            first_moments[k]  = settings.beta1 * first_moments[k]  + (1.0 - settings.beta1) * gradient;
+            second_moments[k] = settings.beta2 * second_moments[k] + (1.0 - settings.beta2) * gradient * gradient;
+
+            const double first  = first_moments[k]  / (1.0 - std::pow(double(settings.beta1), steps));
+            const double second = second_moments[k] / (1.0 - std::pow(double(settings.beta2), steps));
+
+            parameters[k] -= learning_rate * first / (std::sqrt(second) + settings.epsilon);
+        }
+        else
+        {
+            first_moments[k] = settings.momentum * first_moments[k] + gradient;
+            parameters[k] -= learning_rate * first_moments[k];
+        }
+    }
+
+    BinaryData data = network.get_binary_data();
+
+    data.wa = float(parameters[0]);
+    data.wb = float(parameters[1]);
+    data.wc = float(parameters[2]);
+    data.wd = float(parameters[3]);
+    data.we = float(parameters[4]);
+    data.wf = float(parameters[5]);
+
+    network.apply_binary_data(data);
+
+    const double error = batch_error / batch_pixels;
+
+    gradients = {};
+    batch_error = 0.0;
+    batch_pixels = 0;
+    batch_images = 0;
+
+    return error;
+}
+
+/**
+@brief Gets the learning rate the schedule gives for the next update
+@return The learning rate
+*/
+double GradientTrainer::get_learning_rate() const
+{
+    switch (settings.schedule)
+    {
+        case STEP_DECAY:
+
+            return settings.learning_rate * std::pow(double(settings.decay), double(steps / (settings.decay_steps > 0 ? settings.decay_steps : 1)));
+
+        case COSINE:
+        {
+            const double progress = settings.total_steps > 0 && steps < settings.total_steps ? double(steps) / settings.total_steps : 1.0;
+            const double pi = 3.14159265358979323846;
+
+            return settings.minimum_learning_rate + 0.5 * (settings.learning_rate - settings.minimum_learning_rate) * (1.0 + std::cos(pi * progress));
+        }
+
+        default:
+
+            return settings.learning_rate;
+    }
+}
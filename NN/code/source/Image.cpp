@@ -47,8 +47,8 @@ void Image::export_image(std::string path)
 */
 Image::Image(std::string path) : pixels{500 * 500}
 {
-    QPixmap pm(QString(path.c_str()));
-    QImage image = (pm.toImage());
+    // QImage rather than QPixmap, the dataset cache decodes the images out of the main thread
+    QImage image(QString::fromStdString(path));
     width = image.width();
     height = image.height();
     
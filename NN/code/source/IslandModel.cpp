@@ -0,0 +1,272 @@
+#include <IslandModel.hpp>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <thread>
+
+/**
+@brief Creates an island that is not connected to the others yet
+@param settings The islands, this island and the migration
+*/
+IslandModel::IslandModel(const Settings& settings) : settings{settings}
+{
+    this->settings.migrants = std::min<uint32_t>(settings.migrants, max_migrants);
+    last_sequences.assign(settings.islands, 0);
+}
+
+/**
+@brief Detaches from the mailbox
+*/
+IslandModel::~IslandModel()
+{
+    if (memory.isAttached())
+    {
+        memory.detach();
+    }
+}
+
+/**
+@brief Gets the topology of a name given in the command line
+@param name ring or all
+@param topology The topology of the name
+@return True if the name is known
+*/
+bool IslandModel::parse_topology(const std::string& name, topologies& topology)
+{
+    if (name == "ring")
+    {
+        topology = RING;
+    }
+    else if (name == "all")
+    {
+        topology = ALL;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+@brief Creates the mailbox of the islands, before the other islands are launched
+@param key The name of the shared memory, unique to the run
+@return False if the shared memory can not be created
+*/
+bool IslandModel::create(const std::string& key)
+{
+    memory.setKey(QString::fromStdString(key));
+
+    if (!memory.create(int(get_memory_size())))
+    {
+        return false;
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(memory.data());
+
+    Header* header = reinterpret_cast<Header*>(data);
+    header->magic = magic;
+    header->islands = settings.islands;
+    header->reserved = 0;
+
+    slots = reinterpret_cast<Slot*>(data + sizeof(Header));
+
+    for (uint32_t island = 0; island < settings.islands; ++island)
+    {
+        new (&slots[island]) Slot();
+        slots[island].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+/**
+@brief Attaches to the mailbox created by island 0
+@param key The name of the shared memory
+@return False if there is no mailbox for these settings
+*/
+bool IslandModel::attach(const std::string& key)
+{
+    memory.setKey(QString::fromStdString(key));
+
+    if (!memory.attach())
+    {
+        return false;
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(memory.data());
+    const Header* header = reinterpret_cast<const Header*>(data);
+
+    if (size_t(memory.size()) < get_memory_size() || header->magic != magic || header->islands != settings.islands || settings.island >= settings.islands)
+    {
+        memory.detach();
+        return false;
+    }
+
+    slots = reinterpret_cast<Slot*>(data + sizeof(Header));
+
+    return true;
+}
+
+/**
+@brief Publishes the best chromosomes of a generation and the best chromosome of the island
+@param dataset The image the fitness was measured on
+@param generation The generation
+@param chromosomes The chromosomes of the generation, 6 weights per chromosome
+@param fitness The fitness of each chromosome
+@param best The best chromosome of the island
+@param best_fitness Its fitness
+@param finished True once the island finished its training
+*/
+void IslandModel::emigrate(uint32_t dataset, uint32_t generation, const std::vector<float>& chromosomes, const std::vector<float>& fitness,
+                           const std::array<float, genes>& best, float best_fitness, bool finished)
+{
+    if (!is_connected())
+    {
+        return;
+    }
+
+    const size_t candidates = std::min(fitness.size(), chromosomes.size() / genes);
+    const size_t count = std::min<size_t>(settings.migrants, candidates);
+
+    order.resize(candidates);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](size_t a, size_t b) { return fitness[a] < fitness[b]; });
+
+    Message message;
+    message.dataset = dataset;
+    message.generation = generation;
+    message.count = uint32_t(count);
+    message.finished = finished ? 1 : 0;
+    message.best_fitness = best_fitness;
+    message.best = best;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        message.fitness[i] = fitness[order[i]];
+        std::copy(chromosomes.begin() + order[i] * genes, chromosomes.begin() + (order[i] + 1) * genes, message.chromosomes.begin() + i * genes);
+    }
+
+    // Odd while writing, the readers copy the slot again
+    Slot& slot = slots[settings.island];
+    const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&slot.message, &message, sizeof(Message));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    ++statistics.published;
+}
+
+/**
+@brief Places the migrants published since the last call by the islands of the topology at the end of a batch,
+in place of the chromosomes there. They are evaluated with the batch. Never more than half of the batch
+@param dataset The image of the batch, the migrants of another image are dropped
+@param chromosomes The batch, 6 weights per chromosome
+@return The amount of migrants placed
+*/
+size_t IslandModel::immigrate(uint32_t dataset, std::vector<float>& chromosomes)
+{
+    if (!is_connected() || settings.islands < 2 || settings.interval == 0)
+    {
+        return 0;
+    }
+
+    const size_t candidates = chromosomes.size() / genes;
+    const size_t room = candidates / 2;
+    size_t placed = 0;
+
+    for (uint32_t offset = 1; offset < settings.islands && placed < room; ++offset)
+    {
+        // The ring takes from the previous island only
+        if (settings.topology == RING && offset > 1)
+        {
+            break;
+        }
+
+        const uint32_t source = (settings.island + settings.islands - offset) % settings.islands;
+
+        Message message;
+        uint32_t sequence = 0;
+
+        if (!read(source, message, sequence) || sequence == 0 || sequence == last_sequences[source])
+        {
+            continue;
+        }
+
+        last_sequences[source] = sequence;
+
+        if (message.dataset != dataset)
+        {
+            ++statistics.rejected;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < message.count && placed < room; ++i, ++placed)
+        {
+            std::copy(message.chromosomes.begin() + i * genes, message.chromosomes.begin() + (i + 1) * genes, chromosomes.end() - (placed + 1) * genes);
+        }
+    }
+
+    statistics.received += placed;
+
+    return placed;
+}
+
+/**
+@brief Copies the message of an island
+@param island The island
+@param message The message
+@return False if the island has not published yet or kept writing during every copy
+*/
+bool IslandModel::read(uint32_t island, Message& message)
+{
+    uint32_t sequence = 0;
+
+    return read(island, message, sequence) && sequence != 0;
+}
+
+/**
+@brief Copies the message of an island and the sequence it was copied at
+@param island The island
+@param message The message
+@param sequence The sequence of the slot, 0 if the island has not published yet
+@return False if the island kept writing during every copy
+*/
+bool IslandModel::read(uint32_t island, Message& message, uint32_t& sequence)
+{
+    if (!is_connected() || island >= settings.islands)
+    {
+        return false;
+    }
+
+    const Slot& slot = slots[island];
+
+    // A message is a few hundred bytes, the writer is never in the middle of one for long
+    for (int attempt = 0; attempt < 64; ++attempt)
+    {
+        const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+
+        if ((before & 1) == 0)
+        {
+            std::memcpy(&message, &slot.message, sizeof(Message));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+            {
+                sequence = before;
+                return true;
+            }
+        }
+
+        ++statistics.retries;
+        std::this_thread::yield();
+    }
+
+    return false;
+}
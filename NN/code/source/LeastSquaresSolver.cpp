@@ -0,0 +1,325 @@
+#include <LeastSquaresSolver.hpp>
+#include <cmath>
+
+namespace
+{
+    typedef LeastSquaresSolver::Matrix Matrix;
+
+    /**
+    @brief Multiplies two 3x3 matrices
+    @param a The left matrix
+    @param b The right matrix
+    @return a * b
+    */
+    Matrix multiply(const Matrix& a, const Matrix& b)
+    {
+        Matrix result {};
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    result[i * 3 + j] += a[i * 3 + k] * b[k * 3 + j];
+                }
+            }
+        }
+
+        return result;
+    }
+
+    /**
+    @brief Transposes a 3x3 matrix
+    @param a The matrix
+    @return a^T
+    */
+    Matrix transpose(const Matrix& a)
+    {
+        return {a[0], a[3], a[6], a[1], a[4], a[7], a[2], a[5], a[8]};
+    }
+
+    /**
+    @brief Cholesky factor of a symmetric positive definite matrix. A small ridge keeps it defined when the
+    inputs do not span the three components
+    @param a The matrix
+    @return The lower triangular L with L L^T = a
+    */
+    Matrix cholesky(Matrix a)
+    {
+        const double ridge = 1e-12 * (a[0] + a[4] + a[8]) + 1e-300;
+
+        a[0] += ridge;
+        a[4] += ridge;
+        a[8] += ridge;
+
+        Matrix l {};
+
+        for (int j = 0; j < 3; ++j)
+        {
+            double diagonal = a[j * 3 + j];
+
+            for (int k = 0; k < j; ++k)
+            {
+                diagonal -= l[j * 3 + k] * l[j * 3 + k];
+            }
+
+            l[j * 3 + j] = std::sqrt(diagonal > 0.0 ? diagonal : ridge);
+
+            for (int i = j + 1; i < 3; ++i)
+            {
+                double value = a[i * 3 + j];
+
+                for (int k = 0; k < j; ++k)
+                {
+                    value -= l[i * 3 + k] * l[j * 3 + k];
+                }
+
+                l[i * 3 + j] = value / l[j * 3 + j];
+            }
+        }
+
+        return l;
+    }
+
+    /**
+    @brief Inverts a lower triangular matrix
+    @param l The matrix
+    @return l^-1, lower triangular
+    */
+    Matrix invert_lower(const Matrix& l)
+    {
+        Matrix inverse {};
+
+        for (int j = 0; j < 3; ++j)
+        {
+            inverse[j * 3 + j] = 1.0 / l[j * 3 + j];
+
+            for (int i = j + 1; i < 3; ++i)
+            {
+                double value = 0.0;
+
+                for (int k = j; k < i; ++k)
+                {
+                    value -= l[i * 3 + k] * inverse[k * 3 + j];
+                }
+
+                inverse[i * 3 + j] = value / l[i * 3 + i];
+            }
+        }
+
+        return inverse;
+    }
+
+    /**
+    @brief Eigenvector of the largest eigenvalue of a symmetric matrix, with cyclic Jacobi rotations
+    @param a The matrix
+    @return The unit eigenvector
+    */
+    std::array<double, 3> largest_eigenvector(Matrix a)
+    {
+        Matrix vectors = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+        for (int sweep = 0; sweep < 50; ++sweep)
+        {
+            const double off = a[1] * a[1] + a[2] * a[2] + a[5] * a[5];
+
+            if (off <= 1e-30 * (a[0] * a[0] + a[4] * a[4] + a[8] * a[8]))
+            {
+                break;
+            }
+
+            for (int p = 0; p < 2; ++p)
+            {
+                for (int q = p + 1; q < 3; ++q)
+                {
+                    const double apq = a[p * 3 + q];
+
+                    if (apq == 0.0)
+                    {
+                        continue;
+                    }
+
+                    const double theta = (a[q * 3 + q] - a[p * 3 + p]) / (2.0 * apq);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                    const double c = 1.0 / std::sqrt(t * t + 1.0);
+                    const double s = t * c;
+
+                    // a = R^T a R and vectors = vectors R with the rotation R of the plane p, q
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const double akp = a[k * 3 + p];
+                        const double akq = a[k * 3 + q];
+
+                        a[k * 3 + p] = c * akp - s * akq;
+                        a[k * 3 + q] = s * akp + c * akq;
+                    }
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const double apk = a[p * 3 + k];
+                        const double aqk = a[q * 3 + k];
+
+                        a[p * 3 + k] = c * apk - s * aqk;
+                        a[q * 3 + k] = s * apk + c * aqk;
+                    }
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const double vkp = vectors[k * 3 + p];
+                        const double vkq = vectors[k * 3 + q];
+
+                        vectors[k * 3 + p] = c * vkp - s * vkq;
+                        vectors[k * 3 + q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+
+        int largest = 0;
+
+        for (int i = 1; i < 3; ++i)
+        {
+            if (a[i * 3 + i] > a[largest * 3 + largest])
+            {
+                largest = i;
+            }
+        }
+
+        return {vectors[largest], vectors[3 + largest], vectors[6 + largest]};
+    }
+}
+
+/**
+@brief Adds the pixels of an image to the normal equations
+@param histogram The colour table of the image
+*/
+void LeastSquaresSolver::accumulate(const ColorHistogram& histogram)
+{
+    const std::vector<float>& input = histogram.get_input();
+    const std::vector<float>& desired = histogram.get_desired();
+    const std::vector<float>& counts = histogram.get_counts();
+
+    for (size_t c = 0; c < counts.size(); ++c)
+    {
+        const double count = counts[c];
+        const double x[3] = {input[c * 3], input[c * 3 + 1], input[c * 3 + 2]};
+        const double t[3] = {desired[c * 3], desired[c * 3 + 1], desired[c * 3 + 2]};
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                input_gram[i * 3 + j] += count * x[i] * x[j];
+                cross_gram[i * 3 + j] += count * t[i] * x[j];
+            }
+
+            input_sum[i] += count * x[i];
+            desired_energy += count * t[i] * t[i];
+        }
+
+        pixels += count;
+    }
+}
+
+/**
+@brief Solves the normal equations accumulated
+@param first_layer_neurons The amount of input neurons of the network of the solution
+@return The optimum, its rank one factorization and their errors
+*/
+LeastSquaresSolver::Solution LeastSquaresSolver::solve(uint32_t first_layer_neurons) const
+{
+    Solution solution;
+
+    // M A = B, with A = L L^T: M = B L^-T L^-1
+    const Matrix lower = cholesky(input_gram);
+    const Matrix lower_inverse = invert_lower(lower);
+
+    solution.transform = multiply(multiply(cross_gram, transpose(lower_inverse)), lower_inverse);
+    solution.transform_error = get_error(solution.transform);
+
+    // The error of N is the one of M plus |(M - N) L|^2, so the best rank one N is the top singular pair of
+    // K = M L: N = (K v) (L^-T v)^T with v the top eigenvector of K^T K
+    const Matrix k = multiply(solution.transform, lower);
+    const std::array<double, 3> v = largest_eigenvector(multiply(transpose(k), k));
+
+    std::array<double, 3> output_weights {};
+    std::array<double, 3> hidden_weights {};
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            output_weights[i] += k[i * 3 + j] * v[j];
+            hidden_weights[i] += lower_inverse[j * 3 + i] * v[j];
+        }
+    }
+
+    // Same norm for both factors, and a hidden value that is positive for the mean input so the ReLU keeps it
+    double output_norm = 0.0;
+    double hidden_norm = 0.0;
+    double mean_hidden = 0.0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        output_norm += output_weights[i] * output_weights[i];
+        hidden_norm += hidden_weights[i] * hidden_weights[i];
+        mean_hidden += hidden_weights[i] * input_sum[i];
+    }
+
+    const double scale = hidden_norm > 0.0 && output_norm > 0.0 ? std::sqrt(std::sqrt(output_norm / hidden_norm)) : 1.0;
+    const double sign = mean_hidden < 0.0 ? -1.0 : 1.0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        hidden_weights[i] *= sign * scale;
+        output_weights[i] *= sign / scale;
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            solution.factored_transform[i * 3 + j] = output_weights[i] * hidden_weights[j];
+        }
+    }
+
+    solution.factored_error = get_error(solution.factored_transform);
+
+    solution.data.wa = float(hidden_weights[0]);
+    solution.data.wb = float(hidden_weights[1]);
+    solution.data.wc = float(hidden_weights[2]);
+    solution.data.wd = float(output_weights[0]);
+    solution.data.we = float(output_weights[1]);
+    solution.data.wf = float(output_weights[2]);
+    solution.data.first_layer_neurons = first_layer_neurons;
+
+    return solution;
+}
+
+/**
+@brief Gets the mean squared error per pixel of a transform over the pixels accumulated, from the Gram matrices
+@param transform The transform
+@return The error
+*/
+double LeastSquaresSolver::get_error(const Matrix& transform) const
+{
+    if (pixels <= 0.0)
+    {
+        return 0.0;
+    }
+
+    // sum |t - M x|^2 = sum |t|^2 - 2 tr(M^T B) + tr(M A M^T)
+    const Matrix projected = multiply(multiply(transform, input_gram), transpose(transform));
+
+    double error = desired_energy;
+
+    for (int i = 0; i < 9; ++i)
+    {
+        error -= 2.0 * transform[i] * cross_gram[i];
+    }
+
+    error += projected[0] + projected[4] + projected[8];
+
+    return error / pixels;
+}
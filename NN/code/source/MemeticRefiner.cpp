@@ -0,0 +1,111 @@
+#include <MemeticRefiner.hpp>
+#include <GradientTrainer.hpp>
+#include <TiedNeuralNetwork.hpp>
+#include <algorithm>
+#include <numeric>
+
+/**
+@brief Polishes the best chromosomes of a generation and replaces the ones that improve
+@param chromosomes The chromosomes of the generation, 6 weights per chromosome
+@param fitness The fitness of each chromosome. The best ones must be complete
+@param elites The amount of best chromosomes to polish, the amount the optimizer selects at most
+@param histogram The colour table of the image the fitness is measured on
+@return The amount of chromosomes replaced
+*/
+size_t MemeticRefiner::refine(std::vector<float>& chromosomes, std::vector<float>& fitness, size_t elites, const ColorHistogram& histogram)
+{
+    const size_t candidates = std::min(fitness.size(), chromosomes.size() / genes);
+    const size_t count = std::min({elites, size_t(settings.elites), candidates});
+
+    if (count == 0 || histogram.get_colors_count() == 0)
+    {
+        return 0;
+    }
+
+    order.resize(candidates);
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), [&](size_t a, size_t b) { return fitness[a] < fitness[b]; });
+
+    // Every elite is a network of its own with its own Adam moments. The steps of the elites are interleaved,
+    // each one a pass over the colour table
+    GradientTrainer::Settings trainer_settings;
+    trainer_settings.optimizer = GradientTrainer::ADAM;
+    trainer_settings.schedule = GradientTrainer::CONSTANT;
+    trainer_settings.learning_rate = settings.learning_rate;
+    trainer_settings.batch_size = 1;
+
+    std::vector<TiedNeuralNetwork> networks;
+    std::vector<GradientTrainer> trainers;
+    networks.reserve(count);
+    trainers.reserve(count);
+
+    for (size_t e = 0; e < count; ++e)
+    {
+        const float* chromosome = &chromosomes[order[e] * genes];
+
+        BinaryData data;
+        data.wa = chromosome[0];
+        data.wb = chromosome[1];
+        data.wc = chromosome[2];
+        data.wd = chromosome[3];
+        data.we = chromosome[4];
+        data.wf = chromosome[5];
+        data.first_layer_neurons = uint32_t(histogram.get_colors_count() * 3);
+
+        networks.emplace_back(data);
+        trainers.emplace_back(networks.back(), trainer_settings);
+    }
+
+    for (uint32_t step = 0; step < settings.steps; ++step)
+    {
+        for (GradientTrainer& trainer : trainers)
+        {
+            trainer.accumulate(histogram);
+            trainer.step();
+        }
+    }
+
+    statistics.gradient_passes += uint64_t(settings.steps) * count;
+
+    // The polished chromosomes are scored with the fitness of the optimizer
+    polished.resize(count * genes);
+    polished_fitness.resize(count);
+
+    for (size_t e = 0; e < count; ++e)
+    {
+        const BinaryData& data = networks[e].get_binary_data();
+        float* chromosome = &polished[e * genes];
+
+        chromosome[0] = data.wa;
+        chromosome[1] = data.wb;
+        chromosome[2] = data.wc;
+        chromosome[3] = data.wd;
+        chromosome[4] = data.we;
+        chromosome[5] = data.wf;
+    }
+
+    evaluator.evaluate(polished.data(), count, histogram.get_input().data(), histogram.get_desired().data(), histogram.get_counts().data(), histogram.get_colors_count(), polished_fitness.data());
+
+    size_t improved = 0;
+
+    for (size_t e = 0; e < count; ++e)
+    {
+        const size_t index = order[e];
+
+        if (polished_fitness[e] < fitness[index])
+        {
+            statistics.gain += fitness[index] > 0.f ? double(fitness[index] - polished_fitness[e]) / fitness[index] : 0.0;
+
+            std::copy(polished.begin() + e * genes, polished.begin() + (e + 1) * genes, chromosomes.begin() + index * genes);
+            fitness[index] = polished_fitness[e];
+
+            ++improved;
+        }
+    }
+
+    ++statistics.refinements;
+    statistics.polished += count;
+    statistics.improved += improved;
+
+    return improved;
+}
@@ -0,0 +1,183 @@
+#include <NNFastMath.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <math.h>
+#include <vector>
+
+namespace
+{
+    /**
+    @brief Applies a vector function to a collection of values with the widest instruction set available.
+    The values that do not fill a vector go through the SSE2 version on a single lane.
+    @param input The first input value
+    @param output The first output value
+    @param count The amount of values
+    */
+    template <__m128 (*Sse2)(__m128), __m256 (*Avx2)(__m256)>
+    NN_TARGET_AVX2 void run_avx2(const float* input, float* output, size_t count)
+    {
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8)
+        {
+            _mm256_storeu_ps(output + i, Avx2(_mm256_loadu_ps(input + i)));
+        }
+
+        for (; i < count; ++i)
+        {
+            output[i] = _mm_cvtss_f32(Sse2(_mm_set_ss(input[i])));
+        }
+    }
+
+    template <__m128 (*Sse2)(__m128), __m256 (*Avx2)(__m256)>
+    void run_sse2(const float* input, float* output, size_t count)
+    {
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_ps(output + i, Sse2(_mm_loadu_ps(input + i)));
+        }
+
+        for (; i < count; ++i)
+        {
+            output[i] = _mm_cvtss_f32(Sse2(_mm_set_ss(input[i])));
+        }
+    }
+
+    template <__m128 (*Sse2)(__m128), __m256 (*Avx2)(__m256)>
+    void run(const float* input, float* output, size_t count)
+    {
+        if (Simd::get_instruction_set() == Simd::AVX2)
+        {
+            run_avx2<Sse2, Avx2>(input, output, count);
+        }
+        else
+        {
+            run_sse2<Sse2, Avx2>(input, output, count);
+        }
+    }
+
+    /**
+    @brief Applies a scalar function to a collection of values
+    @param input The first input value
+    @param output The first output value
+    @param count The amount of values
+    */
+    template <float (*Function)(float)>
+    void run_precise(const float* input, float* output, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            output[i] = Function(input[i]);
+        }
+    }
+
+    float precise_exp(float x)
+    {
+        return expf(x);
+    }
+}
+
+void NNFastMath::exp(const float* input, float* output, size_t count, modes mode)
+{
+    mode == FAST ? run<exp_sse2, exp_avx2>(input, output, count) : run_precise<precise_exp>(input, output, count);
+}
+
+void NNFastMath::sigmoid(const float* input, float* output, size_t count, modes mode)
+{
+    mode == FAST ? run<sigmoid_sse2, sigmoid_avx2>(input, output, count) : run_precise<NNActivations::Sigmoid::activate>(input, output, count);
+}
+
+void NNFastMath::tanh(const float* input, float* output, size_t count, modes mode)
+{
+    mode == FAST ? run<tanh_sse2, tanh_avx2>(input, output, count) : run_precise<NNActivations::Tanh::activate>(input, output, count);
+}
+
+void NNFastMath::leakyrelu(const float* input, float* output, size_t count, modes mode)
+{
+    mode == FAST ? run<leakyrelu_sse2, leakyrelu_avx2>(input, output, count) : run_precise<NNActivations::LeakyRelu::activate>(input, output, count);
+}
+
+/**
+@brief Measures the error of the fast mode of a batch function over evenly spaced values of a range
+@param function The batch function
+@param reference The double precision version of the function
+@param minimum The minimum value of the range
+@param maximum The maximum value of the range
+@param count The amount of values
+@return The largest errors
+*/
+NNFastMath::Accuracy NNFastMath::measure_accuracy(batch_function function, double (*reference)(double), float minimum, float maximum, size_t count)
+{
+    std::vector<float> input(count);
+    std::vector<float> output(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        input[i] = minimum + (maximum - minimum) * float(i) / float(count - 1);
+    }
+
+    function(input.data(), output.data(), count, FAST);
+
+    Accuracy accuracy;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        double expected = reference(input[i]);
+        float rounded = float(expected);
+        double ulp = double(std::nextafter(std::fabs(rounded), std::numeric_limits<float>::infinity())) - std::fabs(rounded);
+        double error = std::fabs(double(output[i]) - expected);
+
+        accuracy.max_ulp = std::max(accuracy.max_ulp, error / ulp);
+        accuracy.max_absolute = std::max(accuracy.max_absolute, error);
+    }
+
+    return accuracy;
+}
+
+/**
+@brief Measures every approximation and compares it with the bounds documented above, one line per function
+ending with PASS or FAIL
+@param stream Where the lines are written
+@return True if every function is within its bounds
+*/
+bool NNFastMath::check_accuracy(std::ostream& stream)
+{
+    struct Check
+    {
+        const char* name;
+        batch_function function;
+        double (*reference)(double);
+        float minimum;
+        float maximum;
+        double ulp_bound;
+        double absolute_bound;
+    };
+
+    const double unbounded = std::numeric_limits<double>::infinity();
+
+    const Check checks[] =
+    {
+        {"exp      ", exp,       [](double x) { return std::exp(x); },                          -87.f, 88.f, 1.5, unbounded},
+        {"sigmoid  ", sigmoid,   [](double x) { return 1.0 / (1.0 + std::exp(-x)); },           -80.f, 80.f, 3.0, 1e-7},
+        {"tanh     ", tanh,      [](double x) { return std::tanh(x); },                         -80.f, 80.f, 1.5, 1e-7},
+        {"leakyrelu", leakyrelu, [](double x) { return double(NNActivations::LeakyRelu::activate(float(x))); }, -80.f, 80.f, 0.0, 0.0},
+    };
+
+    bool passed = true;
+
+    for (const Check& check : checks)
+    {
+        const Accuracy accuracy = measure_accuracy(check.function, check.reference, check.minimum, check.maximum);
+        const bool within = accuracy.max_ulp <= check.ulp_bound && accuracy.max_absolute <= check.absolute_bound;
+
+        stream << " " << check.name << " [" << check.minimum << ", " << check.maximum << "]: max " << accuracy.max_ulp << " ulp (bound " << check.ulp_bound
+               << "), max absolute error " << accuracy.max_absolute << " (bound " << check.absolute_bound << ") " << (within ? "PASS" : "FAIL") << std::endl;
+
+        passed = passed && within;
+    }
+
+    return passed;
+}
@@ -0,0 +1,83 @@
+#include <NNRandom.hpp>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace
+{
+    std::atomic<uint64_t> run_seed {0};
+    std::atomic<uint64_t> seed_epoch {0};            //< Increased by every set_seed, even with the same seed
+    std::atomic<uint64_t> next_stream {1};          //< Stream 0 is the one of the main thread
+    std::atomic<uint64_t> next_thread_stream {1};
+
+    // The thread streams are far from the allocated ones
+    const uint64_t thread_streams = uint64_t(1) << 63;
+}
+
+/**
+@brief Sets the seed of the run and restarts the streams. The generators already created keep the previous seed
+@param seed The seed
+*/
+void NNRandom::set_seed(uint64_t seed)
+{
+    run_seed = seed;
+    next_stream = 1;
+    next_thread_stream = 1;
+    ++seed_epoch;
+}
+
+/**
+@brief Gets the seed of the run
+@return The seed
+*/
+uint64_t NNRandom::get_seed()
+{
+    return run_seed;
+}
+
+/**
+@brief Generates a seed from the system entropy, meant to be logged and passed back to replay a run
+@return The new seed
+*/
+uint64_t NNRandom::generate_seed()
+{
+    std::random_device device;
+
+    uint64_t seed = (uint64_t(device()) << 32) ^ device();
+    seed ^= uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+
+    return seed;
+}
+
+/**
+@brief Gets a new stream index. The indexes are given in order, so the code that creates the streams in the same
+order gets the same streams
+@return The stream index
+*/
+uint64_t NNRandom::allocate_stream()
+{
+    return next_stream++;
+}
+
+/**
+@brief Gets the generator of the calling thread. The main thread uses stream 0; the other threads get a stream
+in the order they first call this function
+@return The generator of the thread
+*/
+NNRandom& NNRandom::get()
+{
+    static const std::thread::id main_thread = std::this_thread::get_id();
+
+    thread_local NNRandom generator(0);
+    thread_local uint64_t epoch = ~uint64_t(0);
+
+    // A new seed restarts the streams
+    if (epoch != seed_epoch)
+    {
+        epoch = seed_epoch;
+        generator = NNRandom(std::this_thread::get_id() == main_thread ? 0 : thread_streams + next_thread_stream++);
+    }
+
+    return generator;
+}
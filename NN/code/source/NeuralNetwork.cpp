@@ -1,11 +1,13 @@
 #include <NeuralNetwork.hpp>
 #include <iostream>
+#include <algorithm>
 
 /**
 @brief Creates a neural network with the data of a binary file
 @param path The path of the file with the data
+@param resource The memory resource of the layers. It must outlive the network
 */
-NeuralNetwork::NeuralNetwork(std::string path)
+NeuralNetwork::NeuralNetwork(std::string path, std::pmr::memory_resource* resource) : resource{resource}
 {  
     std::ifstream stream;
 
@@ -17,8 +19,8 @@ NeuralNetwork::NeuralNetwork(std::string path)
     BinaryData * data = new BinaryData();
     data->read(content);
 
-    this->layers = new Layer * [3];
     this->layers_count = 3;
+    this->layers = static_cast<Layer**>(resource->allocate(sizeof(Layer*) * layers_count, alignof(Layer*)));
     // The proposed method only has 3 layers connected in a particular way
     // The first or input layer
     initialize_layer(0, data->first_layer_neurons, 0);
@@ -27,31 +29,9 @@ NeuralNetwork::NeuralNetwork(std::string path)
     // The third or output layer
     initialize_layer(2, data->first_layer_neurons, data->first_layer_neurons / 3);
 
-    // Set the wa, wb, wc 
-    Neuron** start = layers[1]->get_neurons();
-    Neuron** end = start + (data->first_layer_neurons / 3);
+    apply_binary_data(*data);
 
-    while (start < end)
-    {
-        (*start)->set_weight(data->wa, 0);
-        (*start)->set_weight(data->wb, 1);
-        (*start)->set_weight(data->wc, 2);      
-
-        ++start;
-    }
-
-    // Set the wd, we, wf
-    start = layers[2]->get_neurons();
-    end = start + (data->first_layer_neurons);
-
-    while (start < end)
-    {
-        (*start)->set_weight(data->wd, 0);
-        (*(start + 1))->set_weight(data->we, 0);
-        (*(start + 2))->set_weight(data->wf, 0);    
-              
-        start += 3;
-    }    
+    delete data;
 }
 
 /**
@@ -62,14 +42,8 @@ void NeuralNetwork::export_network(std::string path)
 {
     BinaryData* data = new BinaryData();    
 
-    data->wa = layers[1]->get_neurons()[0]->get_weights()[0];
-    data->wb = layers[1]->get_neurons()[0]->get_weights()[1];
-    data->wc = layers[1]->get_neurons()[0]->get_weights()[2];
-    data->wd = layers[2]->get_neurons()[0]->get_weights()[0];
-    data->we = layers[2]->get_neurons()[1]->get_weights()[0];
-    data->wf = layers[2]->get_neurons()[2]->get_weights()[0];
+    *data = get_binary_data();
 
-    data->first_layer_neurons = layers[0]->get_neurons_size();
     
     std::ofstream stream(path.c_str());
     
@@ -88,31 +62,33 @@ void NeuralNetwork::export_network(std::string path)
 */
 void NeuralNetwork::apply_binary_data(BinaryData data)
 {
-    // Set the wa, wb, wc 
-    Neuron** start = layers[1]->get_neurons();
-    Neuron** end = start + (data.first_layer_neurons / 3);
+    // Set the wa, wb, wc
+    float* start = layers[1]->get_weights();
+    float* end = start + size_t(layers[1]->get_neurons_size()) * layers[1]->get_weights_per_neuron();
 
     while (start < end)
     {
-        (*start)->set_weight(data.wa, 0);
-        (*start)->set_weight(data.wb, 1);
-        (*start)->set_weight(data.wc, 2);
+        start[0] = data.wa;
+        start[1] = data.wb;
+        start[2] = data.wc;
 
-        ++start;
+        start += 3;
     }
 
     // Set the wd, we, wf
-    start = layers[2]->get_neurons();
-    end = start + (data.first_layer_neurons);
+    start = layers[2]->get_weights();
+    end = start + layers[2]->get_neurons_size();
 
     while (start < end)
     {
-        (*start)->set_weight(data.wd, 0);
-        (*(start + 1))->set_weight(data.we, 0);
-        (*(start + 2))->set_weight(data.wf, 0);
+        start[0] = data.wd;
+        start[1] = data.we;
+        start[2] = data.wf;
 
         start += 3;
     }
+
+    tied = true;
 }
 
 /**
@@ -121,21 +97,27 @@ void NeuralNetwork::apply_binary_data(BinaryData data)
 @param output A pointer to the first output
 */
 void NeuralNetwork::feed_forward(std::vector<float>& inputs, std::vector<float>& outputs)
-{    
-    int iterator = 0;
-
-    // Set the input
-    Neuron**  start = layers[0]->get_neurons();
-    Neuron** end = start + layers[0]->get_neurons_size();
-
-    while (start < end)
+{
+    if (tied)
     {
-        (*start)->set_value(inputs[iterator]);
-        
-        ++iterator;
-        ++start;
+        // Only the hidden values are kept, the back propagation reads the output layer values from the outputs
+        compile().run(inputs.data(), outputs.data(), layers[1]->get_values(), layers[1]->get_neurons_size(), ThreadPool::get());
+        return;
     }
 
+    feed_forward_graph(inputs, outputs);
+}
+
+/**
+@brief Calculates the value of each neuron walking all the layers of the network. The output is stored in the given parameter.
+@param inputs A pointer to the first input
+@param output A pointer to the first output
+*/
+void NeuralNetwork::feed_forward_graph(std::vector<float>& inputs, std::vector<float>& outputs)
+{    
+    // Set the input
+    std::copy(inputs.begin(), inputs.begin() + layers[0]->get_neurons_size(), layers[0]->get_values());
+
     // Calculate the hidden layers
     // In the proposed method there is only 1 hidden layer. 
     // If there will be more than 1, this must be into a for loop from index 1 to index layers_count - 1
@@ -162,88 +144,67 @@ void NeuralNetwork::feed_forward(std::vector<float>& inputs, std::vector<float>&
     ...                      ...                         ...                       ...                         ...
 
     */
-    start = layers[1]->get_neurons();
-    end = start + layers[1]->get_neurons_size();
+    float* start = layers[1]->get_values();
+    float* end = start + layers[1]->get_neurons_size();
+
+    const float* weights = layers[1]->get_weights();
+    const float* previous_layer_start = layers[0]->get_values();
 
-    Neuron** previous_layer_start = layers[0]->get_neurons();
-    Neuron** previous_layer_end = previous_layer_start + layers[0]->get_neurons_size();
-        
-    int count = 0;
-    
     while (start < end)
     {
-        float value = (*previous_layer_start)->get_value()  * (*start)->get_weights()[0];
-        value += (*(previous_layer_start + 1))->get_value() * (*start)->get_weights()[1];
-        value += (*(previous_layer_start + 2))->get_value() * (*start)->get_weights()[2];       
+        float value = previous_layer_start[0]  * weights[0];
+        value += previous_layer_start[1]       * weights[1];
+        value += previous_layer_start[2]       * weights[2];
 
-        (*start)->set_value(activate(value, layers[1]->get_activation())); 
-        //(*start)->set_value(value);
+        (*start) = value;
 
         ++start;
+        weights += 3;
         previous_layer_start += 3;
-        count++;
     }
 
+    layers[1]->activate(layers[1]->get_values(), layers[1]->get_neurons_size());
+
     // Calculate the output layer
-    start = layers[2]->get_neurons();
+    start = layers[2]->get_values();
     end = start + layers[2]->get_neurons_size();
 
-    previous_layer_start = layers[1]->get_neurons();    
-
-    iterator = 0;
+    weights = layers[2]->get_weights();
+    previous_layer_start = layers[1]->get_values();
 
     while (start < end)
     {
         // This process can be in a loop (each last hidden layer neuron generates 3 output neurons)
         // Here the loop is omitted to prevent the conditional process
 
-        float value = (*previous_layer_start)->get_value() * (*start)->get_weights()[0];
-        value = activate(value, layers[2]->get_activation());        
-        (*start)->set_value(value);
-        outputs[iterator] = value;
-        ++start;
-        ++iterator;
-
-        value = (*previous_layer_start)->get_value() * (*start)->get_weights()[0];
-        value = activate(value, layers[2]->get_activation());
-        
-        (*start)->set_value(value);
-        outputs[iterator] = value;
-        ++start;
-        ++iterator;
-
-        value = (*previous_layer_start)->get_value() * (*start)->get_weights()[0];
-        value = activate(value, layers[2]->get_activation());
-
-        (*start)->set_value(value);
-        outputs[iterator] = value;
-        ++start;
-        ++iterator;
+        start[0] = (*previous_layer_start) * weights[0];
+        start[1] = (*previous_layer_start) * weights[1];
+        start[2] = (*previous_layer_start) * weights[2];
 
+        start   += 3;
+        weights += 3;
         ++previous_layer_start;
     }
 
+    layers[2]->activate(layers[2]->get_values(), layers[2]->get_neurons_size());
+
+    std::copy(layers[2]->get_values(), end, outputs.begin());
 }
 
 /**
-@brief Calculates the backpropagation
-@param output The output values of the information proccess of the feed_forward output
+@brief Calculates the backpropagation: a gradient descent step of the tied weights with the mean of the
+gradients of every neuron, the same step as TiedNeuralNetwork::back_propagation. The deltas go through the
+derivates of the activations of each layer. An untied network is tied from the weights of its first neurons.
+The sums of the gradients are the same with any amount of threads
+@param inputs The input values of the feed_forward process
+@param output The output values of the feed_forward process
 @param desired The desired values
 */
-void NeuralNetwork::back_propagation(std::vector<float> & output, std::vector<float> & desired)
+void NeuralNetwork::back_propagation(const std::vector<float>& inputs, const std::vector<float>& output, const std::vector<float>& desired)
 {
-    int iterator = 0;
-
-    float wa = 0.f, wb = 0.f, wc = 0.f, wd = 0.f, we = 0.f, wf = 0.f;
-
-    Neuron** start = layers[2]->get_neurons();
-    Neuron** end = start + layers[2]->get_neurons_size();
-    float value = 0.f;
-
-    // Output adjustment
     // In the proposed method, all the triplets of weights between output layer and last hidden layer must
-    // be adjusted like there are the same weights. For this reason, the adjustment has to be acumulated and 
-    // applied after an average calculation. 
+    // be adjusted like there are the same weights. For this reason, the gradients of every neuron are
+    // acumulated and the step is made with their mean.
     // The nomenclature follows this structure:
 
     /*
@@ -268,94 +229,77 @@ void NeuralNetwork::back_propagation(std::vector<float> & output, std::vector<fl
 
 
     */
-    
-    while (start < end)
-    {        
-        (*start)      ->set_delta( output[iterator] - desired[iterator]);
-        (*(start + 1))->set_delta( output[iterator + 1] - desired[iterator + 1]);
-        (*(start + 2))->set_delta( output[iterator + 2] - desired[iterator + 2]);
-
-        wd += (*start)->get_weights()[0] + ((*start)->get_delta() * learning_rate * (*start)->get_value());
-        we += (*(start + 1))->get_weights()[0] + ((*(start+1))->get_delta() * learning_rate * (*(start + 1))->get_value());
-        wf += (*(start + 2))->get_weights()[0] + ((*(start + 2))->get_delta() * learning_rate * (*(start + 2))->get_value());
-        
-        if (isinf(wd) || isinf(we) || isinf(wf))
-        {
-            int i = 0;
-        }
 
-        start     += 3;
-        iterator  += 3;              
+    const uint32_t hidden_size = layers[1]->get_neurons_size();
+
+    if (hidden_size == 0)
+    {
+        return;
     }
 
-    //float divider = 1.f / float(layers[2]->get_neurons_size());
-      
-    start = layers[2]->get_neurons();
-    
-    /*wd *= divider;
-    we *= divider;
-    wf *= divider;*/
+    // The pixels are split in chunks between the threads. The sums of the chunks are reduced with a fixed tree,
+    // so the result is the same with any amount of threads
+    ThreadPool& pool = ThreadPool::get();
+    std::vector<std::array<double, 6>> partials(ThreadPool::get_chunks_count(hidden_size));
 
-    while (start < end)
-    {
-        (*start)->get_weights()[0] = wd;
-        (*(start + 1))->get_weights()[0] = we;
-        (*(start + 2))->get_weights()[0] = wf;
+    const float* values = layers[1]->get_values();
+    const float* hidden_weights = layers[1]->get_weights();
+    const float* output_weights = layers[2]->get_weights();
 
-        start += 3;
-    }   
+    float* hidden_deltas = layers[1]->get_deltas();
+    float* output_deltas = layers[2]->get_deltas();
 
-    if (isnan(wd) || isnan(we) || isnan(wf))
+    // Gradients of the squared error 0.5 * |output - desired|^2, in the order wa, wb, wc, wd, we, wf
+    pool.parallel_for(hidden_size, [&](size_t chunk, size_t begin, size_t end)
     {
-        int i = 0;
-    }
+        // The derivates of the activations of both layers, from the activated values of the chunk
+        std::vector<float> output_derivates((end - begin) * 3);
+        std::vector<float> hidden_derivates(end - begin);
 
-    // Hidden layers
-    // In the proposed method there is only one hidden layer. If this is not your case, you have
-    // to add this into a for loop
+        layers[2]->derivate(output.data() + begin * 3, output_derivates.data(), output_derivates.size());
+        layers[1]->derivate(values + begin, hidden_derivates.data(), hidden_derivates.size());
 
-    start = layers[1]->get_neurons();
-    end = start + layers[1]->get_neurons_size();
-    Neuron** next_layer_start = layers[2]->get_neurons();
+        std::array<double, 6> sums {};
 
-    while (start < end)
-    {
-        value = (*next_layer_start)->get_delta() * wd;
-        value += (*(next_layer_start + 1))->get_delta() * we;
-        value += (*(next_layer_start + 2))->get_delta() * wf;
+        for (size_t i = begin; i < end; ++i)
+        {
+            float back = 0.f;
 
-        value = (*start)->get_delta() - value;
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const size_t j = i * 3 + k;
 
-        (*start)->set_delta(value);
+                output_deltas[j] = (output[j] - desired[j]) * output_derivates[j - begin * 3];
 
-        wa += (*start)->get_weights()[0] + (value * learning_rate * (*start)->get_value());
-        wb += (*start)->get_weights()[1] + (value * learning_rate * (*start)->get_value());
-        wc += (*start)->get_weights()[2] + (value * learning_rate * (*start)->get_value());
+                sums[3 + k] += output_deltas[j] * values[i];
+                back += output_deltas[j] * output_weights[j];
+            }
 
-        if (isnan(wa) || isnan(wb) || isnan(wc))
-        {
-            int i = 0;
+            hidden_deltas[i] = back * hidden_derivates[i - begin];
+
+            sums[0] += hidden_deltas[i] * inputs[i * 3];
+            sums[1] += hidden_deltas[i] * inputs[i * 3 + 1];
+            sums[2] += hidden_deltas[i] * inputs[i * 3 + 2];
         }
 
-        ++start;
-        next_layer_start += 3;
-    }
-    
-    //divider = 1.f / float(layers[1]->get_neurons_size());
+        partials[chunk] = sums;
+    });
 
-    /*wa *= divider;
-    wb *= divider;
-    wc *= divider;*/
-    start = layers[1]->get_neurons();
+    const std::array<double, 6> sums = ThreadPool::tree_reduce(partials);
+    const double step = learning_rate / double(hidden_size);
 
-    while (start < end)
-    {
-        (*start)->get_weights()[0] = wa;
-        (*start)->get_weights()[1] = wb;
-        (*start)->get_weights()[2] = wc;
+    BinaryData data;
 
-        ++start;
-    }
+    data.wa = float(hidden_weights[0] - step * sums[0]);
+    data.wb = float(hidden_weights[1] - step * sums[1]);
+    data.wc = float(hidden_weights[2] - step * sums[2]);
+    data.wd = float(output_weights[0] - step * sums[3]);
+    data.we = float(output_weights[1] - step * sums[4]);
+    data.wf = float(output_weights[2] - step * sums[5]);
+
+    data.first_layer_neurons = layers[0]->get_neurons_size();
+
+    apply_binary_data(data);
 }
 
 /**
@@ -368,31 +312,7 @@ void NeuralNetwork::genetic_training(std::vector<float>& output, std::vector<flo
     // Set the own cromosome 
     BinaryData cromosome1;
 
-    // Set the wa, wb, wc 
-    Neuron** start = layers[1]->get_neurons();
-    Neuron** end = start + (cromosome1.first_layer_neurons / 3);
-
-    while (start < end)
-    {
-        (*start)->set_weight(cromosome1.wa, 0);
-        (*start)->set_weight(cromosome1.wb, 1);
-        (*start)->set_weight(cromosome1.wc, 2);
-
-        ++start;
-    }
-
-    // Set the wd, we, wf
-    start = layers[2]->get_neurons();
-    end = start + (cromosome1.first_layer_neurons);
-
-    while (start < end)
-    {
-        (*start)->set_weight(cromosome1.wd, 0);
-        (*(start + 1))->set_weight(cromosome1.we, 0);
-        (*(start + 2))->set_weight(cromosome1.wf, 0);
-
-        start += 3;
-    }
+    apply_binary_data(cromosome1);
 
 
     // Create the other cromosomes
@@ -2,90 +2,194 @@
 #include <NeuralNetwork.hpp>
 #include "..\headers\NeuralNetworkApplication.hpp"
 #include <limits>
+#include <cstring>
+#include <cmath>
+#include <numeric>
+#include <list>
+#include <thread>
 
 /**
-@brief Train the neural network with images of the given size
+@brief Train the neural network with mini-batch gradient descent over images of the given size
 @param image_width The width of the image
 @param image_height The height of the image
+@param data_path The path of the network data. The training starts from it and exports the result to it
 */
-void NeuralNetworkApplication::training(uint16_t image_width, uint16_t image_height)
+void NeuralNetworkApplication::training(uint16_t image_width, uint16_t image_height, std::string data_path)
 {
-    uint16_t dataset_count = 1049; //1049 max
-    uint16_t training_iterations = 1;
+    const uint16_t dataset_count = 64; //1049 max
+    const uint16_t training_iterations = 4;
     std::string path = "../../assets/training_dataset/";
 
-    uint32_t size = image_width * image_height * 3;
+    const uint32_t size = image_width * image_height * 3;
 
     std::vector <float > neural_network_input (size);
     std::vector <float > neural_network_output (size);
-    std::vector <float > neural_network_desired_output (size);    
+    std::vector <float > neural_network_desired_output (size);
+
+    open_dataset_cache(path);
 
     // Load data from parsed network
-    NeuralNetwork net("../../assets/data/data.dat");
-      
+    TiedNeuralNetwork net(data_path);
+
+    GradientTrainer::Settings settings;
+    settings.optimizer = GradientTrainer::ADAM;
+    settings.schedule = GradientTrainer::COSINE;
+    settings.batch_size = 8;
+    settings.total_steps = (dataset_count * training_iterations + settings.batch_size - 1) / settings.batch_size;
+
+    GradientTrainer trainer(net, settings);
+
+    // Ends the training once the error of the updates stops going down
+    ConvergenceMonitor::Settings convergence_settings;
+    convergence_settings.window = convergence_window;
+    convergence_settings.patience = convergence_patience;
+    convergence_settings.minimum_improvement = minimum_improvement;
+
+    ConvergenceMonitor convergence(convergence_settings);
+    double lowest_error = std::numeric_limits<double>::max();
+
+    // The gradients only depend on the colours of an image, each image is trained through its colour table
+    ColorHistogram histogram;
+    uint64_t total_pixels = 0;
+    uint64_t total_colors = 0;
 
     // Training
-   for (uint16_t i = 0; i < training_iterations; ++i)
+    for (uint16_t i = 0; i < training_iterations && !convergence.has_stopped(); ++i)
     {
-        for (uint16_t j = 0; j < dataset_count; ++j)
+        for (uint16_t j = 0; j < dataset_count && !convergence.has_stopped(); ++j)
         {
-            Image img(path + std::to_string(j) + ".png");
-            Image output_img(img.get_width(), img.get_height());
+            TrainingImage image = load_training_image(path, j, neural_network_input, neural_network_desired_output);
 
-            extract_input_from_image(img, neural_network_input);
+            histogram.build(image.input, image.desired, image.pixels);
+            trainer.accumulate(histogram);
 
-            //get_sobel_values(img, neural_network_desired_output);
+            total_pixels += histogram.get_pixels_count();
+            total_colors += histogram.get_colors_count();
 
-            net.feed_forward(neural_network_input, neural_network_output);
-           
-            // Create the generated image. This is for debug proporse only                    
+            // Update the weights once the batch is full or with the last images
+            if (trainer.is_batch_full() || (i + 1 == training_iterations && j + 1 == dataset_count && trainer.has_pending_images()))
+            {
+                double learning_rate = trainer.get_learning_rate();
+                double error = trainer.step();
+
+                // Each batch has other images, the lowest error and the error of the batch are both averaged
+                lowest_error = std::min(lowest_error, error);
+                convergence.update(float(lowest_error), float(error));
+
+                std::cout << std::endl << " Evaluation: " + data_path << " (seed " << NNRandom::get_seed() << ")" << std::endl
+                                       << " Update " << trainer.get_steps() << " / " << settings.total_steps
+                                       << " learning rate " << learning_rate << " mean error " << error << std::endl
+                                       << " Colour table: " << histogram.get_colors_count() << " colours of " << histogram.get_pixels_count() << " pixels (x"
+                                       << histogram.get_compression_ratio() << "), x" << double(total_pixels) / std::max<uint64_t>(1, total_colors) << " over the images" << std::endl
+                                       << " Training iteration: " << std::to_string(i * dataset_count + j + 1) << " / " << std::to_string(dataset_count * training_iterations) << std::endl;
+            }
+        }
+    }
 
-            int iterator = 0;
+    convergence.finish();
 
-            for (auto& pixel : output_img.get_pixels())
-            {
-                pixel.rgb_components.red = limit(neural_network_output[iterator], 0.f, 1.f);
-                pixel.rgb_components.green = limit(neural_network_output[iterator + 1], 0.f, 1.f);
-                pixel.rgb_components.blue = limit(neural_network_output[iterator + 2], 0.f, 1.f);
+    const ConvergenceMonitor::Stop& stop = convergence.get_stop();
+
+    std::cout << std::endl << " Training " << ConvergenceMonitor::get_reason_name(stop.reason) << " after " << trainer.get_steps() << " of " << settings.total_steps
+              << " updates, lowest error " << lowest_error << ", " << 100.0 * stop.mean_improvement << "% lower error over the last window" << std::endl;
 
-                iterator += 3;
-            }            
+    // Same measure as the genetic training, to compare both
+    TrainingImage image = load_training_image(path, 0, neural_network_input, neural_network_desired_output);
 
-            img.export_image("../../assets/data/original.png");
-            output_img.export_image("../../assets/data/postFF.png");
+    // The network passes take the buffers, an image of the dataset cache is copied to them
+    if (image.input != neural_network_input.data())
+    {
+        std::copy(image.input, image.input + image.pixels * 3, neural_network_input.begin());
+        std::copy(image.desired, image.desired + image.pixels * 3, neural_network_desired_output.begin());
+    }
 
-           // parse_output(img, neural_network_output, output_img);                       
+    net.feed_forward(neural_network_input, neural_network_output);
 
-            lms_daltonization(img, neural_network_desired_output);            
+    std::cout << std::endl << " Genetic fitness of the first image: " << calculate_fitness(neural_network_output, neural_network_desired_output) << std::endl;
 
-            for (auto& f : neural_network_desired_output)
-            {
-                if (f < 0)
-                {
-                    int i = 0;
-                }
-            }
+    // Save the neural network values in file
+    net.export_network(data_path);
+}
+
+/**
+@brief Fits the network in closed form: streams the training set once to accumulate the normal equations
+of the LUV transform and exports the best transform the tied weights can hold
+@param image_width The width of the image
+@param image_height The height of the image
+@param data_path The path where the network data is exported
+*/
+void NeuralNetworkApplication::least_squares(uint16_t image_width, uint16_t image_height, std::string data_path)
+{
+    const uint16_t dataset_count = 1049; //1049 max
+    std::string path = "../../assets/training_dataset/";
+
+    const uint32_t size = image_width * image_height * 3;
+
+    std::vector <float > neural_network_input (size);
+    std::vector <float > neural_network_output (size);
+    std::vector <float > neural_network_desired_output (size);
 
-            net.back_propagation(neural_network_output, neural_network_desired_output);        
+    ColorHistogram histogram;
+    LeastSquaresSolver solver;
 
-            //system("cls");
-            std::cout << std::endl << std::to_string(i * dataset_count + j) << " of " << std::to_string(dataset_count * training_iterations)<<std::endl;
-            
-       }
+    open_dataset_cache(path);
+
+    // A single pass over the training set
+    for (uint16_t j = 0; j < dataset_count; ++j)
+    {
+        TrainingImage image = load_training_image(path, j, neural_network_input, neural_network_desired_output);
+
+        histogram.build(image.input, image.desired, image.pixels);
+        solver.accumulate(histogram);
+
+        std::cout << "\r Images: " << j + 1 << " / " << dataset_count << std::flush;
     }
 
-    // Save the neural network values in file
-    net.export_network("/../../assets/data/data.dat");    
+    LeastSquaresSolver::Solution solution = solver.solve(size);
+
+    std::cout << std::endl << " Pixels: " << solver.get_pixels_count() << std::endl
+              << " Optimum transform: ";
+
+    for (double coefficient : solution.transform)
+    {
+        std::cout << coefficient << " ";
+    }
+
+    std::cout << std::endl << " Mean squared error of the optimum : " << solution.transform_error << std::endl
+              << " Mean squared error of the rank one: " << solution.factored_error << std::endl
+              << " Weights: " << solution.data.to_string() << std::endl;
+
+    // Same measure as the genetic training, to compare both. The activations apply here
+    TiedNeuralNetwork net(solution.data);
+
+    TrainingImage image = load_training_image(path, 0, neural_network_input, neural_network_desired_output);
+
+    // The network passes take the buffers, an image of the dataset cache is copied to them
+    if (image.input != neural_network_input.data())
+    {
+        std::copy(image.input, image.input + image.pixels * 3, neural_network_input.begin());
+        std::copy(image.desired, image.desired + image.pixels * 3, neural_network_desired_output.begin());
+    }
+
+    net.feed_forward(neural_network_input, neural_network_output);
+
+    std::cout << std::endl << " Genetic fitness of the first image: " << calculate_fitness(neural_network_output, neural_network_desired_output) << std::endl;
+
+    net.export_network(data_path);
 }
 
 /**
-@brief Train the network with genetic algorithm
+@brief Train the network with genetic algorithm. Every image of a few gets all the generations, or with
+batch_images every generation is scored over a new random batch of the whole training set. With
+checkpoint_interval the run is saved next to the network data, and resume continues from there. With
+convergence_patience an image ends once its fitness stops improving
 */
 void NeuralNetworkApplication::genetic_training(uint16_t image_width, uint16_t image_height, std::string data_path)
 {
-    const uint8_t network_count = 20;
-    const uint8_t genetic_generations = 100;
-    const uint16_t dataset_count = 5; //1049 max
+    const uint32_t network_count = population_size;
+    const bool batch_mode = batch_images > 0;
+    const uint16_t dataset_count = batch_mode ? 1049 : 5; //1049 max
+    const uint16_t image_steps = batch_mode ? 1 : dataset_count;
     const uint16_t training_iterations = 1;
     
     std::string path = "../../assets/training_dataset/";
@@ -94,117 +198,848 @@ void NeuralNetworkApplication::genetic_training(uint16_t image_width, uint16_t i
 
     std::vector <float > neural_network_input(size);    
     std::vector <float > neural_network_desired_output(size);
-    
-    uint8_t best_parent_index = 0;
-    uint8_t second_best_parent_index = 0;
 
-    // Create random networks
-    std::vector<std::shared_ptr<NeuralNetwork>> networks(network_count);
+    // The pixels of the images of a batch one after the other
+    std::vector <float > batch_input;
+    std::vector <float > batch_desired;
+
+    // The fitness of different batches can not be compared, the exported chromosome is the best of the last batch
+    std::array <float, Optimizer::genes> batch_best {};
+    float batch_best_fitness = std::numeric_limits<float>::max();
+    std::chrono::duration<double, std::milli> batch_time {};
+
+    // The chromosomes asked by the optimizer and their fitness, one row per chromosome
+    std::vector <float > fitness(network_count);
+    std::vector <float > chromosomes(network_count * PopulationEvaluator::genes);
+
+    // Fitness of the chromosomes already evaluated in this run, the copies of the parents are not evaluated again
+    FitnessCache fitness_cache;
+    std::vector <float > pending_chromosomes;
+    std::vector <float > pending_fitness;
+    std::vector <uint8_t > pending_complete;
+
+    // Model of the fitness of the current image that ranks the chromosomes to evaluate, only the most promising
+    // surrogate_fraction of them are evaluated
+    SurrogateModel surrogate;
+    std::vector <float > screened_chromosomes;
+    std::vector <float > screened_fitness;
+    std::vector <uint8_t > screened_complete;
+    std::vector <size_t > screened_indices;
+
+    // Island model: every island is a process with a population of its own and its share of the hardware threads.
+    // Island 0 creates the mailbox, launches the others and exports the best chromosome of all of them
+    IslandModel::Settings island_settings;
+    island_settings.islands = islands;
+    island_settings.island = island;
+    island_settings.interval = migration_interval;
+    island_settings.migrants = migrants;
+    island_settings.topology = island_topology;
+
+    IslandModel island_model(island_settings);
+    std::vector<std::unique_ptr<QProcess>> island_processes;
+
+    // Before the islands are launched, so they map the file island 0 compiles
+    open_dataset_cache(path);
+
+    if (islands > 1)
+    {
+        ThreadPool::get().set_threads_count(std::max(1u, std::thread::hardware_concurrency() / islands));
+
+        if (island == 0)
+        {
+            const std::string mailbox = "NN_islands_" + std::to_string(applicationPid());
+
+            if (island_model.create(mailbox))
+            {
+                island_processes = launch_islands(mailbox);
+            }
+            else
+            {
+                std::cout << std::endl << " The island mailbox could not be created, training a single population" << std::endl;
+            }
+        }
+        else if (!island_model.attach(island_mailbox))
+        {
+            std::cout << std::endl << " No island mailbox " << island_mailbox << ", training without migration" << std::endl;
+        }
+    }
+
+    // Create random networks. The whole population lives in one arena that is released at once
+    auto setup_start = std::chrono::steady_clock::now();
+
+    std::pmr::monotonic_buffer_resource population_memory(sizeof(TiedNeuralNetwork) * network_count);
+    std::pmr::vector<TiedNeuralNetwork> networks(&population_memory);
+    networks.reserve(network_count);
     initialize_networks(networks, network_count - 1);
 
-    networks[network_count - 1] = std::make_shared<NeuralNetwork>(data_path);
+    networks.emplace_back(data_path);
+
+    std::chrono::duration<double, std::milli> setup_time = std::chrono::steady_clock::now() - setup_start;
+    std::cout << std::endl << " Population setup: " << setup_time.count() << " ms" << std::endl;
+
+    // The fitness runs use the fast activations, the exported parameters do not depend on the mode
+    for (auto& network : networks)
+    {
+        network.set_math_mode(NNFastMath::FAST);
+    }
+
+    // The first population of the optimizer, the loaded network last
+    for (size_t neural_network_index = 0; neural_network_index < networks.size(); ++neural_network_index)
+    {
+        const BinaryData& data = networks[neural_network_index].get_binary_data();
+        float* chromosome = &chromosomes[neural_network_index * PopulationEvaluator::genes];
+
+        chromosome[0] = data.wa;
+        chromosome[1] = data.wb;
+        chromosome[2] = data.wc;
+        chromosome[3] = data.wd;
+        chromosome[4] = data.we;
+        chromosome[5] = data.wf;
+    }
+
+    std::unique_ptr<Optimizer> optimizer = Optimizer::create(optimizer_strategy, chromosomes);
+    optimizer->set_rescoring(batch_mode);
+
+    // Best fitness after each generation of the current image, for the convergence report
+    std::vector<std::pair<uint64_t, float>> history;
+
+    // Scores the whole population in one pass over each level of the image, stopping with the candidates that
+    // can not be selected
+    PopulationEvaluator evaluator(networks[0].get_hidden_activation(), networks[0].get_output_activation(), NNFastMath::FAST);
+    ProgressiveEvaluator progressive_evaluator(evaluator);
+
+    // Gradient polishing of the elites every memetic_interval generations
+    MemeticRefiner::Settings memetic_settings;
+    memetic_settings.interval = memetic_interval;
+
+    MemeticRefiner memetic_refiner(evaluator, memetic_settings);
+
+    // Moves to the next image once the best and mean fitness stop improving. How each image ended is reported
+    // at the end of the training
+    ConvergenceMonitor::Settings convergence_settings;
+    convergence_settings.window = convergence_window;
+    convergence_settings.patience = convergence_patience;
+    convergence_settings.minimum_improvement = minimum_improvement;
+
+    ConvergenceMonitor convergence(convergence_settings);
+    std::vector<std::pair<uint32_t, ConvergenceMonitor::Stop>> stops;
+    uint64_t generations_run = 0;
+
+    ColorHistogram histogram;
+    uint64_t total_pixels = 0;
+    uint64_t total_colors = 0;
+
+    // The next image and generation to run, moved forward by a resumed checkpoint
+    uint32_t first_step = 0;
+    uint32_t first_generation = 0;
+    uint64_t first_evaluation = 0;
+
+    // Snapshots of the run between two generations. The state is copied to a payload and the file is written
+    // while the next generations run
+    const std::string checkpoint_path = data_path + (island > 0 ? ".island" + std::to_string(island) : "") + ".checkpoint";
+    Checkpoint checkpoint;
+
+    // The settings that shape the run, a checkpoint only resumes a run with the same ones
+    const std::array<uint32_t, 9> run_settings = {uint32_t(optimizer_strategy), population_size, genetic_generations, batch_images, memetic_interval, uint32_t(evaluation), uint32_t(type),
+                                                 convergence_patience, convergence_window};
+
+    auto save_checkpoint = [&](uint32_t step, uint32_t generation)
+    {
+        // The cursor is the next generation to run
+        if (generation == genetic_generations)
+        {
+            ++step;
+            generation = 0;
+        }
+
+        std::vector<uint64_t> history_evaluations;
+        std::vector<float> history_fitness;
+
+        for (const auto& entry : history)
+        {
+            history_evaluations.push_back(entry.first);
+            history_fitness.push_back(entry.second);
+        }
+
+        std::vector<uint8_t> payload;
+        CheckpointWriter writer(payload);
+
+        writer.write(run_settings);
+        writer.write(surrogate_fraction);
+        writer.write(minimum_improvement);
+        writer.write(NNRandom::get_seed());
+        writer.write(NNRandom::get().get_position());
+        writer.write(step);
+        writer.write(generation);
+        writer.write(first_evaluation);
+        writer.write_vector(history_evaluations);
+        writer.write_vector(history_fitness);
+        writer.write(batch_best);
+        writer.write(batch_best_fitness);
+
+        optimizer->save(writer);
+        surrogate.save(writer);
+        fitness_cache.save(writer);
+        convergence.save(writer);
+
+        checkpoint.save_async(checkpoint_path, std::move(payload));
+    };
+
+    if (resume)
+    {
+        std::vector<uint8_t> payload;
+        std::string failure;
+
+        if (!Checkpoint::load(checkpoint_path, payload))
+        {
+            failure = "no valid checkpoint at " + checkpoint_path;
+        }
+        else
+        {
+            CheckpointReader reader(payload);
+
+            std::array<uint32_t, 9> saved_settings {};
+            float saved_fraction = 0.f;
+            float saved_improvement = 0.f;
+            uint64_t seed = 0;
+            uint64_t position = 0;
+            uint32_t step = 0;
+            uint32_t generation = 0;
+            uint64_t evaluation_offset = 0;
+            std::vector<uint64_t> history_evaluations;
+            std::vector<float> history_fitness;
+
+            reader.read(saved_settings);
+            reader.read(saved_fraction);
+            reader.read(saved_improvement);
+            reader.read(seed);
+            reader.read(position);
+            reader.read(step);
+            reader.read(generation);
+            reader.read(evaluation_offset);
+            reader.read_vector(history_evaluations);
+            reader.read_vector(history_fitness);
+            reader.read(batch_best);
+            reader.read(batch_best_fitness);
+
+            if (!reader.is_valid() || saved_settings != run_settings || saved_fraction != surrogate_fraction || saved_improvement != minimum_improvement)
+            {
+                failure = "the checkpoint was written with other settings";
+            }
+            else if (!optimizer->load(reader) || !surrogate.load(reader) || !fitness_cache.load(reader) || !convergence.load(reader) || !reader.is_complete() || history_evaluations.size() != history_fitness.size())
+            {
+                failure = "the checkpoint is incomplete";
+
+                // The optimizer may be half restored
+                optimizer = Optimizer::create(optimizer_strategy, chromosomes);
+                optimizer->set_rescoring(batch_mode);
+                surrogate.clear();
+            }
+            else
+            {
+                // The generator continues the stream of the run, whatever seed this one was given
+                NNRandom::set_seed(seed);
+                NNRandom::get().set_position(position);
+
+                first_step = step;
+                first_generation = generation;
+                first_evaluation = evaluation_offset;
+
+                for (size_t k = 0; k < history_evaluations.size(); ++k)
+                {
+                    history.emplace_back(history_evaluations[k], history_fitness[k]);
+                }
+
+                std::cout << std::endl << " Resumed from " << checkpoint_path << " at training iteration " << step << ", genetic iteration " << generation
+                          << " (seed " << seed << ")" << std::endl;
+            }
+        }
+
+        if (!failure.empty())
+        {
+            std::cout << std::endl << " Not resumed, " << failure << ". Starting over" << std::endl;
+
+            batch_best = {};
+            batch_best_fitness = std::numeric_limits<float>::max();
+        }
+    }
 
     // Do the training for each image and each training iteration
     for (uint16_t i = 0; i < training_iterations; ++i)
     {
-        for (uint16_t j = 0; j < dataset_count; ++j)
+        for (uint16_t j = 0; j < image_steps; ++j)
         {
-            // Extract input
-            Image img(path + std::to_string(j) + ".png");
-            Image output_img(img.get_width(), img.get_height());
-
-            extract_input_from_image(img, neural_network_input);
-            
-            //img.export_image("../../assets/data/original.png");
+            // The images a resumed run already went through
+            if (uint32_t(i) * image_steps + j < first_step)
+            {
+                continue;
+            }
 
-            // Extract desired outputs
-            if (evaluation == evaluation_type::LMS)
+            if (!batch_mode)
             {
-                lms_daltonization(img, neural_network_desired_output);
+                // Extract input and desired outputs
+                TrainingImage image = load_training_image(path, j, neural_network_input, neural_network_desired_output);
+
+                // The fitness only depends on the colours of the image, the population is scored over its colour table
+                histogram.build(image.input, image.desired, image.pixels);
+                progressive_evaluator.set_image(histogram);
+
+                total_pixels += histogram.get_pixels_count();
+                total_colors += histogram.get_colors_count();
             }
-            else if (evaluation == evaluation_type::RGB)
+
+            // The fitness values of the previous image do not apply to this one. A run resumed in the middle of the
+            // image keeps the ones of the checkpoint
+            if (first_generation == 0)
             {
-                rgb_daltonization(img, neural_network_desired_output);           
+                optimizer->reset_fitness();
+                surrogate.clear();
+                history.clear();
+                convergence.reset();
+
+                first_evaluation = optimizer->get_evaluations();
             }
 
             // For each genetic iteration
-            for (uint8_t genetic_iteration = 0; genetic_iteration < genetic_generations; ++genetic_iteration)
+            for (uint32_t genetic_iteration = first_generation; genetic_iteration < genetic_generations; ++genetic_iteration)
             {
-                int neural_network_index = 0;
-                
-                best_parent_index = 0;
-                second_best_parent_index = 0;
+                // A new batch of the training set for every generation. The surrogate keeps learning across the
+                // batches, it only ranks the chromosomes
+                if (batch_mode)
+                {
+                    auto batch_start = std::chrono::steady_clock::now();
+
+                    load_training_batch(path, dataset_count, neural_network_input, neural_network_desired_output, batch_input, batch_desired);
+
+                    histogram.build(batch_input, batch_desired);
+                    progressive_evaluator.set_image(histogram);
+
+                    // No later generation scores this batch, the cache only holds the copies within a generation
+                    fitness_cache.clear();
+
+                    batch_time = std::chrono::steady_clock::now() - batch_start;
+
+                    total_pixels += histogram.get_pixels_count();
+                    total_colors += histogram.get_colors_count();
+                }
+
+                // Every batch is a dataset of its own for the cache
+                const uint32_t dataset = batch_mode ? dataset_count + genetic_iteration : j;
 
-                float best_delta = std::numeric_limits<float>::max();
-                float second_best_delta = std::numeric_limits<float>::max();
+                optimizer->ask(chromosomes);
 
-                // For each neural network generated
-                for (auto& net : networks)
+                // The migrants of the other islands take the place of the last chromosomes of the batch
+                if (optimizer->accepts_migrants())
                 {
-                    std::vector <float > neural_network_output(size);                    
+                    island_model.immigrate(uint32_t(i) * image_steps + j, chromosomes);
+                }
 
-                    net->feed_forward(neural_network_input, neural_network_output);
+                const size_t candidates = chromosomes.size() / PopulationEvaluator::genes;
 
-                    // Create the generated image. This is for debug proporse only                 
-                    /*int iterator = 0;
+                // Only the chromosomes not seen yet on this image are evaluated
+                fitness.assign(candidates, std::numeric_limits<float>::max());
 
-                    for (auto& pixel : output_img.get_pixels())
-                    {
-                        pixel.luv_components.l  = limit(neural_network_output[iterator], 0.f, 1.f);
-                        pixel.luv_components.u  = limit(neural_network_output[iterator + 1], 0.f, 1.f);
-                        pixel.luv_components.v  = limit(neural_network_output[iterator + 2], 0.f, 1.f);
-
-                        iterator += 3;
-                    }*/
-                    //output_img.export_image("../../assets/data/post_element_" + std::to_string(neural_network_index) + ".png");
-            
-                    // Calculate delta                   
-                    int iterator = 0;
-                    float delta = 0;
-
-                    while (iterator < size)
-                    {
-                        Pixel first;
-                        Pixel second;
+                const size_t pending_count = fitness_cache.lookup(chromosomes.data(), candidates, dataset, evaluation * 3 + type, fitness.data(), pending_chromosomes);
 
-                        first.luv_components  = Pixel::LUV(neural_network_output[iterator], neural_network_output[iterator + 1], neural_network_output[iterator + 2]);
-                        second.luv_components = Pixel::LUV(neural_network_desired_output[iterator], neural_network_desired_output[iterator + 1], neural_network_desired_output[iterator + 2]);
+                // The surrogate keeps the most promising share of the chromosomes to evaluate once it has learnt
+                // enough of the image, the rest are told with the maximum fitness
+                const bool screening = surrogate_fraction > 0.f && optimizer->accepts_screening();
+                const size_t kept = screening ? std::max<size_t>(1, size_t(std::ceil(surrogate_fraction * pending_count))) : pending_count;
+                const size_t screened_count = surrogate.screen(pending_chromosomes.data(), pending_count, kept, screened_chromosomes, screened_indices);
 
-                        delta += calculate_delta(first, second);                                        
-                        iterator += 3;
-                    }
+                // The cached fitness values are the first rejection threshold
+                screened_fitness.resize(screened_count);
+                progressive_evaluator.evaluate(screened_chromosomes.data(), screened_count, optimizer->get_selected_count(candidates), fitness, screened_fitness.data(), screened_complete);
 
-                    if (delta < best_delta)
-                    {
-                        best_parent_index = neural_network_index;
-                        best_delta = delta;
-                    }
-                    else if (delta < second_best_delta)
+                // The rejected chromosomes are learnt with the estimate of their levels scored
+                if (screening)
+                {
+                    surrogate.learn(screened_chromosomes.data(), progressive_evaluator.get_estimates().data(), screened_count);
+                }
+
+                pending_fitness.assign(pending_count, std::numeric_limits<float>::max());
+                pending_complete.assign(pending_count, 0);
+
+                for (size_t screened = 0; screened < screened_count; ++screened)
+                {
+                    pending_fitness[screened_indices[screened]] = screened_fitness[screened];
+                    pending_complete[screened_indices[screened]] = screened_complete[screened];
+                }
+
+                // The rejected candidates keep a lower bound that is above the selected ones, they are not cached
+                fitness_cache.store(pending_fitness.data(), pending_complete.data(), fitness.data());
+
+                // The polished elites take the place of the originals before the optimizer selects and recombines.
+                // CMA-ES adapts from the steps it sampled, a polished fitness would rank a step it never reached
+                if (optimizer->accepts_migrants() && memetic_refiner.is_due(genetic_iteration))
+                {
+                    memetic_refiner.refine(chromosomes, fitness, optimizer->get_selected_count(candidates), histogram);
+                }
+
+                optimizer->tell(chromosomes, fitness);
+                history.emplace_back(optimizer->get_evaluations() - first_evaluation, optimizer->get_best_fitness());
+
+                if (batch_mode)
+                {
+                    const size_t best = std::min_element(fitness.begin(), fitness.end()) - fitness.begin();
+
+                    std::copy(chromosomes.begin() + best * Optimizer::genes, chromosomes.begin() + (best + 1) * Optimizer::genes, batch_best.begin());
+                    batch_best_fitness = fitness[best];
+                }
+
+                if (island_model.is_due(genetic_iteration))
+                {
+                    island_model.emigrate(uint32_t(i) * image_steps + j, genetic_iteration, chromosomes, fitness, batch_mode ? batch_best : optimizer->get_best_chromosome(),
+                                          batch_mode ? batch_best_fitness : optimizer->get_best_fitness());
+                }
+
+                // Mean of the fitness values known, the rejected chromosomes count with their lower bound
+                double fitness_sum = 0.0;
+                size_t fitness_count = 0;
+
+                for (float value : fitness)
+                {
+                    if (value < std::numeric_limits<float>::max())
                     {
-                        second_best_parent_index = neural_network_index;
-                        second_best_delta = delta;
+                        fitness_sum += value;
+                        ++fitness_count;
                     }
+                }
 
-                    neural_network_index++;
-                }             
+                convergence.update(batch_mode ? batch_best_fitness : optimizer->get_best_fitness(), float(fitness_sum / std::max<size_t>(1, fitness_count)));
+                ++generations_run;
+
+                // A stopped image is saved as finished
+                if (checkpoint_interval > 0 && ((genetic_iteration + 1) % checkpoint_interval == 0 || genetic_iteration + 1 == genetic_generations || convergence.has_stopped()))
+                {
+                    save_checkpoint(uint32_t(i) * image_steps + j, convergence.has_stopped() ? genetic_generations : genetic_iteration + 1);
+                }
 
-                // Recombine
-                recombine_networks(networks, best_parent_index, second_best_parent_index);
+            const ProgressiveEvaluator::Statistics& rejection = progressive_evaluator.get_statistics();
+            const MemeticRefiner::Statistics& memetic = memetic_refiner.get_statistics();
+            const SurrogateModel::Statistics& surrogate_statistics = surrogate.get_statistics();
 
             system("cls");
-            std::cout << std::endl << " Evaluation: " + data_path << std::endl
+            std::cout << std::endl << " Evaluation: " + data_path << " (seed " << NNRandom::get_seed() << ", optimizer " << optimizer->get_name() << ")" << std::endl
+                                   << " Best fitness      : " << (batch_mode ? batch_best_fitness : optimizer->get_best_fitness()) << " after " << optimizer->get_evaluations() - first_evaluation << " evaluations" << std::endl
                                    << " Genetic iteration : " << std::to_string(genetic_iteration) << " / " << std::to_string(genetic_generations) << std::endl
-                                   << " Training iteration: " << std::to_string(i * dataset_count + j) << " / " << std::to_string(dataset_count * training_iterations) << std::endl;                                 
+                                   << " Training iteration: " << std::to_string(i * image_steps + j) << " / " << std::to_string(image_steps * training_iterations) << std::endl
+                                   << " Fitness throughput: " << evaluator.get_throughput() / 1e6 << " Mpixel-candidates/s" << std::endl
+                                   << " Fitness cache hits: " << fitness_cache.get_hit_rate() * 100.0 << "% of " << fitness_cache.get_size() << " chromosomes" << std::endl
+                                   << " Colour table      : " << histogram.get_colors_count() << " colours of " << histogram.get_pixels_count() << " pixels (x"
+                                   << histogram.get_compression_ratio() << "), x" << double(total_pixels) / std::max<uint64_t>(1, total_colors) << " over the images" << std::endl
+                                   << " Early rejection   : " << 100.0 * rejection.rejected / std::max<uint64_t>(1, rejection.candidates) << "% of the candidates evaluated, "
+                                   << 100.0 * rejection.pixel_candidates / std::max<uint64_t>(1, rejection.full_pixel_candidates) << "% of the colours scored" << std::endl;
+
+            if (batch_mode)
+            {
+                std::cout << " Batch             : " << batch_images << " of " << dataset_count << " images, best mean delta "
+                          << batch_best_fitness / std::max<uint64_t>(1, histogram.get_pixels_count()) << " per pixel, loaded in " << batch_time.count() << " ms" << std::endl;
+            }
+
+            if (memetic_interval > 0 && !optimizer->accepts_migrants())
+            {
+                std::cout << " Memetic polishing : not applied, " << optimizer->get_name() << " only adapts from its own samples" << std::endl;
+            }
+            else if (memetic_interval > 0)
+            {
+                std::cout << " Memetic polishing : every " << memetic_interval << " generations, " << memetic.improved << " of " << memetic.polished
+                          << " elites improved by " << 100.0 * memetic.gain / std::max<uint64_t>(1, memetic.improved) << "% on average, "
+                          << memetic.gradient_passes << " gradient passes" << std::endl;
+            }
+
+            if (surrogate_fraction > 0.f)
+            {
+                std::cout << " Surrogate model   : " << 100.0 * surrogate_statistics.last_error << "% mean error of the last predictions, "
+                          << 100.0 * surrogate_statistics.error_sum / std::max<uint64_t>(1, surrogate_statistics.predictions) << "% over the run, "
+                          << 100.0 * surrogate_statistics.screened_out / std::max<uint64_t>(1, surrogate_statistics.proposed) << "% of the evaluations saved" << std::endl;
+            }
+
+            if (checkpoint_interval > 0)
+            {
+                std::cout << " Checkpoint        : every " << checkpoint_interval << " generations to " << checkpoint_path << ", " << checkpoint.get_written_count()
+                          << " written (" << checkpoint.get_failed_count() << " failed), the last in " << checkpoint.get_last_write_time() << " ms" << std::endl;
+            }
+
+            if (island_model.is_connected())
+            {
+                const IslandModel::Statistics& migration = island_model.get_statistics();
+
+                std::cout << " Islands           : island " << island << " of " << islands << ", " << migration.published << " migrations sent, "
+                          << migration.received << " migrants received, " << migration.rejected << " of another image dropped, "
+                          << migration.retries << " mailbox reads retried" << std::endl;
+            }
+
+            if (convergence_patience > 0)
+            {
+                const ConvergenceMonitor::Stop& progress = convergence.get_stop();
+
+                std::cout << " Early stopping    : " << convergence.get_stalled_steps() << " of " << convergence_patience << " stalled generations, best "
+                          << 100.0 * progress.best_improvement << "% and mean " << 100.0 * progress.mean_improvement << "% better over the last "
+                          << convergence_window << " generations" << std::endl;
+            }
+
+            if (convergence.has_stopped())
+            {
+                break;
             }
+            }
+
+            first_generation = 0;
+
+            convergence.finish();
+            stops.emplace_back(uint32_t(i) * image_steps + j, convergence.get_stop());
 
-            // Export the data of the  best generated network
-            networks[best_parent_index]->export_network(data_path);
+            // Convergence of the image: evaluations until the best fitness came close to the final one. The
+            // fitness of different batches can not be compared
+            if (!batch_mode)
+            {
+                const float final_fitness = optimizer->get_best_fitness();
+
+                std::cout << " Convergence       : within 10% after " << get_evaluations_to_target(history, final_fitness * 1.1f)
+                          << " evaluations, within 1% after " << get_evaluations_to_target(history, final_fitness * 1.01f) << std::endl;
+            }
+
+            // Export the data of the  best generated network. The other islands leave it to island 0
+            if (island == 0)
+            {
+                export_chromosome(networks.back(), batch_mode ? batch_best : optimizer->get_best_chromosome(), data_path);
+            }
         }
     } 
-    
+
+    // Why each image ended, and the generations the early stopping saved
+    std::cout << std::endl << " Generations run: " << generations_run << " of " << uint64_t(genetic_generations) * image_steps * training_iterations << std::endl;
+
+    for (const auto& image_stop : stops)
+    {
+        const ConvergenceMonitor::Stop& stop = image_stop.second;
+
+        std::cout << " Training iteration " << image_stop.first << ": " << ConvergenceMonitor::get_reason_name(stop.reason) << " after " << stop.step
+                  << " generations, best fitness " << stop.best << ", best " << 100.0 * stop.best_improvement << "% and mean "
+                  << 100.0 * stop.mean_improvement << "% better over the last window" << std::endl;
+    }
+
+    std::array<float, Optimizer::genes> best_chromosome = batch_mode ? batch_best : optimizer->get_best_chromosome();
+    float best_fitness = batch_mode ? batch_best_fitness : optimizer->get_best_fitness();
+
+    // Every island publishes its best chromosome, island 0 takes the best of all once the others finished. The
+    // islands end on the same image; with batches each island scores its own, the fitness values are close
+    if (island_model.is_connected())
+    {
+        island_model.emigrate(uint32_t(training_iterations) * image_steps - 1, genetic_generations, chromosomes, fitness, best_chromosome, best_fitness, true);
+
+        if (island == 0)
+        {
+            uint32_t best_island = 0;
+
+            for (auto& process : island_processes)
+            {
+                process->waitForFinished(-1);
+            }
+
+            for (uint32_t other = 1; other < islands; ++other)
+            {
+                IslandModel::Message message;
+
+                if (island_model.read(other, message) && message.finished && message.best_fitness < best_fitness)
+                {
+                    best_chromosome = message.best;
+                    best_fitness = message.best_fitness;
+                    best_island = other;
+                }
+            }
+
+            std::cout << std::endl << " Islands: best fitness " << best_fitness << " from island " << best_island << " of " << islands << std::endl;
+        }
+    }
+
     // Export the data of the  best generated network
-    networks[best_parent_index]->export_network(data_path);
+    if (island == 0)
+    {
+        export_chromosome(networks.back(), best_chromosome, data_path);
+    }
+
+    // The networks own no memory of their own, releasing the arena frees the population in one shot
+    auto teardown_start = std::chrono::steady_clock::now();
+
+    networks.clear();
+    population_memory.release();
+
+    std::chrono::duration<double, std::milli> teardown_time = std::chrono::steady_clock::now() - teardown_start;
+    std::cout << std::endl << " Population teardown: " << teardown_time.count() << " ms" << std::endl;
+}
+
+/**
+@brief Loads batch_images random images of the training set, without repetition, as one sequence of pixels
+@param path The folder of the training set
+@param dataset_count The amount of images of the training set
+@param image_input Buffer for the input values of one image
+@param image_desired Buffer for the desired values of one image
+@param input The input values of the batch
+@param desired The desired values of the batch
+*/
+void NeuralNetworkApplication::load_training_batch(const std::string& path, uint16_t dataset_count, std::vector<float>& image_input, std::vector<float>& image_desired, std::vector<float>& input, std::vector<float>& desired)
+{
+    const uint32_t count = std::min<uint32_t>(batch_images, dataset_count);
+
+    // The first count entries of a partial shuffle
+    std::vector<uint16_t> indices(dataset_count);
+    std::iota(indices.begin(), indices.end(), uint16_t(0));
+
+    NNRandom& random = NNRandom::get();
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        std::swap(indices[k], indices[k + random.next() % (dataset_count - k)]);
+    }
+
+    input.clear();
+    desired.clear();
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        TrainingImage image = load_training_image(path, indices[k], image_input, image_desired);
+
+        input.insert(input.end(), image.input, image.input + image.pixels * 3);
+        desired.insert(desired.end(), image.desired, image.desired + image.pixels * 3);
+    }
+}
+
+/**
+@brief Maps the compiled training set, compiling the images whose PNG file changed since first. The launched
+islands only map a file island 0 already compiled
+@param path The folder of the training set
+*/
+void NeuralNetworkApplication::open_dataset_cache(const std::string& path)
+{
+    if (!use_dataset_cache || dataset_cache.is_open())
+    {
+        return;
+    }
+
+    // Next to the folder, "training_dataset/" gives "training_dataset.cache"
+    const std::string cache_path = path.substr(0, path.find_last_not_of("/\\") + 1) + ".cache";
+
+    if (!DatasetCache::is_current(path, cache_path))
+    {
+        if (island > 0)
+        {
+            std::cout << std::endl << " No compiled training set, decoding the images" << std::endl;
+            return;
+        }
+
+        std::cout << std::endl << " Compiling the training set to " << cache_path << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        uint32_t decoded = 0;
+        const uint32_t count = DatasetCache::compile(path, cache_path, decoded);
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+        if (count == 0)
+        {
+            std::cout << " The training set could not be compiled, decoding the images" << std::endl;
+            return;
+        }
+
+        std::cout << " " << count << " images, " << decoded << " decoded, in " << time.count() << " s" << std::endl;
+    }
+
+    if (!dataset_cache.open(cache_path))
+    {
+        std::cout << std::endl << " The compiled training set could not be mapped, decoding the images" << std::endl;
+    }
+}
+
+/**
+@brief Loads an image of the training set and its desired values. Both are read in place from the dataset cache
+once it is open, or decoded from the PNG file
+@param path The folder of the training set
+@param index The image
+@param input Buffer for the input values, used when the image is decoded from its PNG file
+@param desired Buffer for the desired values, used when the image is decoded from its PNG file
+@return The input and desired values of the image
+*/
+NeuralNetworkApplication::TrainingImage NeuralNetworkApplication::load_training_image(const std::string& path, uint16_t index, std::vector<float>& input, std::vector<float>& desired)
+{
+    if (dataset_cache.is_open() && index < dataset_cache.get_count())
+    {
+        // The RGB daltonization does not depend on the impairment
+        const DatasetCache::targets target = evaluation == evaluation_type::RGB ? DatasetCache::RGB_DALTONIZATION : DatasetCache::targets(DatasetCache::LMS_DEUTERANOPIA + type);
+
+        return {dataset_cache.get_luv(index), dataset_cache.get_target(index, target), dataset_cache.get_pixels_count(index)};
+    }
+
+    Image img(path + std::to_string(index) + ".png");
+
+    extract_input_from_image(img, input);
+
+    if (evaluation == evaluation_type::LMS)
+    {
+        lms_daltonization(img, desired);
+    }
+    else if (evaluation == evaluation_type::RGB)
+    {
+        rgb_daltonization(img, desired);
+    }
+
+    return {input.data(), desired.data(), size_t(img.get_width()) * img.get_height()};
+}
+
+/**
+@brief Launches the other islands of the genetic training, this executable with the same command line and the
+island, task, mailbox and seed of each one
+@param mailbox The key of the shared memory of the islands
+@return The processes launched
+*/
+std::vector<std::unique_ptr<QProcess>> NeuralNetworkApplication::launch_islands(const std::string& mailbox)
+{
+    std::vector<std::unique_ptr<QProcess>> processes;
+
+    for (uint32_t index = 1; index < islands; ++index)
+    {
+        // The settings added last replace the ones of the command line. The genetic training options of the
+        // menu are 1 to 3, one per impairment
+        QStringList island_arguments;
+
+        for (const std::string& argument : arguments)
+        {
+            island_arguments << QString::fromStdString(argument);
+        }
+
+        const uint64_t seed = NNRandom::get_seed() ^ (0x9E3779B97F4A7C15ull * index);
+
+        island_arguments << "--island" << QString::number(index) << "--task" << QString::number(uint32_t(type) + 1)
+                         << "--mailbox" << QString::fromStdString(mailbox) << "--seed" << QString::number(seed);
+
+        auto process = std::make_unique<QProcess>();
+        process->setProgram(applicationFilePath());
+        process->setArguments(island_arguments);
+        process->setStandardOutputFile(QProcess::nullDevice());
+        process->start();
+
+        if (!process->waitForStarted())
+        {
+            std::cout << std::endl << " Island " << index << " could not be launched" << std::endl;
+            continue;
+        }
+
+        processes.push_back(std::move(process));
+    }
+
+    return processes;
+}
+
+/**
+@brief Runs every optimizer, and the genetic one with the memetic polishing, from the same population over
+the images of the genetic training and reports the evaluations each one needs to reach the best fitness found
+@param image_width The width of the image
+@param image_height The height of the image
+*/
+void NeuralNetworkApplication::compare_optimizers(uint16_t image_width, uint16_t image_height)
+{
+    const uint16_t dataset_count = 5;
+    std::string path = "../../assets/training_dataset/";
+
+    const uint32_t size = image_width * image_height * 3;
+
+    std::vector <float > image_input(size);
+    std::vector <float > image_desired(size);
+    std::vector <float > neural_network_input;
+    std::vector <float > neural_network_desired_output;
+
+    open_dataset_cache(path);
+
+    // The training set as one colour table, so the fitness is the one of the whole set
+    for (uint16_t j = 0; j < dataset_count; ++j)
+    {
+        TrainingImage image = load_training_image(path, j, image_input, image_desired);
+
+        neural_network_input.insert(neural_network_input.end(), image.input, image.input + image.pixels * 3);
+        neural_network_desired_output.insert(neural_network_desired_output.end(), image.desired, image.desired + image.pixels * 3);
+    }
 
+    ColorHistogram histogram;
+    histogram.build(neural_network_input, neural_network_desired_output);
+
+    // The same first population for every optimizer
+    std::vector <float > population(population_size * Optimizer::genes);
+    NNRandom(NNRandom::allocate_stream()).fill(population.data(), population.size(), -5.f, 5.f);
+
+    PopulationEvaluator evaluator(NNActivations::RELU, NNActivations::RELU, NNFastMath::FAST);
+
+    // The last run is the genetic algorithm with the memetic polishing, every 10 generations unless set
+    const Optimizer::strategies strategies[] = {Optimizer::GENETIC, Optimizer::CMA_ES, Optimizer::DIFFERENTIAL_EVOLUTION, Optimizer::GENETIC};
+    const uint32_t memetic_intervals[] = {0, 0, 0, memetic_interval > 0 ? memetic_interval : 10};
+
+    std::vector<std::string> names;
+    std::vector<std::vector<std::pair<uint64_t, float>>> histories;
+    std::vector<double> times;
+
+    std::vector <float > chromosomes;
+    std::vector <float > fitness;
+
+    for (size_t run = 0; run < std::size(strategies); ++run)
+    {
+        std::unique_ptr<Optimizer> optimizer = Optimizer::create(strategies[run], population);
+        std::vector<std::pair<uint64_t, float>> history;
+
+        MemeticRefiner::Settings memetic_settings;
+        memetic_settings.interval = memetic_intervals[run];
+
+        MemeticRefiner memetic_refiner(evaluator, memetic_settings);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t generation = 0; generation < genetic_generations; ++generation)
+        {
+            optimizer->ask(chromosomes);
+
+            const size_t candidates = chromosomes.size() / Optimizer::genes;
+            fitness.resize(candidates);
+
+            evaluator.evaluate(chromosomes.data(), candidates, histogram.get_input().data(), histogram.get_desired().data(), histogram.get_counts().data(), histogram.get_colors_count(), fitness.data());
+
+            if (optimizer->accepts_migrants() && memetic_refiner.is_due(generation))
+            {
+                memetic_refiner.refine(chromosomes, fitness, optimizer->get_selected_count(candidates), histogram);
+            }
+
+            optimizer->tell(chromosomes, fitness);
+            history.emplace_back(optimizer->get_evaluations(), optimizer->get_best_fitness());
+        }
+
+        std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+
+        // The gradient passes of the polishing are not fitness evaluations, they are reported apart
+        const MemeticRefiner::Statistics& memetic = memetic_refiner.get_statistics();
+
+        names.push_back(memetic_intervals[run] > 0 ? std::string(optimizer->get_name()) + "+memetic (" + std::to_string(memetic.gradient_passes) + " gradient passes, "
+                                                     + std::to_string(memetic.improved) + " of " + std::to_string(memetic.polished) + " elites improved)"
+                                                   : std::string(optimizer->get_name()));
+        histories.push_back(std::move(history));
+        times.push_back(time.count());
+    }
+
+    // The targets are relative to the best fitness any optimizer found
+    float best_fitness = std::numeric_limits<float>::max();
+
+    for (const auto& history : histories)
+    {
+        best_fitness = std::min(best_fitness, history.back().second);
+    }
+
+    std::cout << std::endl << " Optimizers over " << dataset_count << " images (" << histogram.get_colors_count() << " colours), "
+              << population_size << " chromosomes per generation, " << genetic_generations << " generations" << std::endl
+              << " Evaluations to reach the best fitness found (" << best_fitness << ") within 10% and 1%, 0 if never" << std::endl;
+
+    for (size_t i = 0; i < histories.size(); ++i)
+    {
+        std::cout << " " << names[i] << ": final " << histories[i].back().second
+                  << ", 10%: " << get_evaluations_to_target(histories[i], best_fitness * 1.1f)
+                  << ", 1%: " << get_evaluations_to_target(histories[i], best_fitness * 1.01f)
+                  << ", " << times[i] << " ms" << std::endl;
+    }
 }
 
 /**
@@ -277,15 +1112,8 @@ void NeuralNetworkApplication::transform(std::string filename, std::string data_
     img.export_image(export_path);
 
 
-    float w1 = data.wa * data.wd;
-    float w2 = data.wb * data.wd;
-    float w3 = data.wc * data.wd;
-    float w4 = data.wa * data.we;
-    float w5 = data.wb * data.we;
-    float w6 = data.wc * data.we;
-    float w7 = data.wa * data.wf;
-    float w8 = data.wb * data.wf;
-    float w9 = data.wc * data.wf;
+    // The network folded into its per pixel kernel
+    PixelKernel kernel(data);
 
     // Calculate transformed    
     
@@ -299,17 +1127,14 @@ void NeuralNetworkApplication::transform(std::string filename, std::string data_
         float g = pixel.rgb_components.green;
         float b = pixel.rgb_components.blue;
 
-        float l = pixel.luv_components.l;
-        float u = pixel.luv_components.u;
-        float v = pixel.luv_components.v;
+        float luv[3] = { pixel.luv_components.l, pixel.luv_components.u, pixel.luv_components.v };
+        float transformed[3];
 
-        float Li = l * w1 + u * w2 + v * w3;
-        float Ui = l * w4 + u * w5 + v * w6;
-        float Vi = l * w7 + u * w8 + v * w9;
+        kernel.apply(luv, transformed);
 
-        pixel.luv_components.l    = Li;
-        pixel.luv_components.u    = Ui;
-        pixel.luv_components.v    = Vi;
+        pixel.luv_components.l    = transformed[0];
+        pixel.luv_components.u    = transformed[1];
+        pixel.luv_components.v    = transformed[2];
                 
         pixel.convert_luv_to_rgb();  
         
@@ -464,3 +1289,178 @@ void NeuralNetworkApplication::lms_daltonization(Image& original, std::vector<fl
 
    copy_pixel_components_to_float(original.get_pixels(), original.get_width() * original.get_height(), output_values);
 }
+
+/**
+@brief Measures the network passes over a training image and checks that the fast paths match the graph walk
+@param image_width The width of the image
+@param image_height The height of the image
+*/
+void NeuralNetworkApplication::benchmark(uint16_t image_width, uint16_t image_height)
+{
+    const uint32_t size = image_width * image_height * 3;
+    const int repetitions = 10;
+
+    std::vector <float > neural_network_input(size);
+    std::vector <float > graph_output(size);
+    std::vector <float > kernel_output(size);
+
+    Image img("../../assets/training_dataset/0.png");
+    extract_input_from_image(img, neural_network_input);
+
+    NeuralNetwork net(size);
+    TiedNeuralNetwork tied(size);
+    net.apply_binary_data(tied.get_binary_data());
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i)
+    {
+        net.feed_forward_graph(neural_network_input, graph_output);
+    }
+    std::chrono::duration<double, std::milli> graph_time = (std::chrono::steady_clock::now() - start) / repetitions;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i)
+    {
+        net.feed_forward(neural_network_input, kernel_output);
+    }
+    std::chrono::duration<double, std::milli> kernel_time = (std::chrono::steady_clock::now() - start) / repetitions;
+
+    bool equal = std::memcmp(graph_output.data(), kernel_output.data(), sizeof(float) * size) == 0;
+
+    std::cout << std::endl << " Feed forward " << image_width << "x" << image_height << ", " << ThreadPool::get().get_threads_count() << " threads" << std::endl
+              << " Graph walk  : " << graph_time.count()  << " ms" << std::endl
+              << " Pixel kernel (" << Simd::get_name(Simd::get_instruction_set()) << "): " << kernel_time.count() << " ms (x" << graph_time.count() / kernel_time.count() << ")"
+              << (equal ? " bit-identical" : " MISMATCH") << std::endl;
+
+    // Population of graph networks, one allocation per array against a single arena
+    const int population = 4;
+
+    start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::unique_ptr<NeuralNetwork>> networks;
+
+        for (int i = 0; i < population; ++i)
+        {
+            networks.push_back(std::make_unique<NeuralNetwork>(size));
+        }
+    }
+    std::chrono::duration<double, std::milli> heap_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+        std::pmr::monotonic_buffer_resource population_memory;
+        std::pmr::list<NeuralNetwork> networks(&population_memory);
+
+        for (int i = 0; i < population; ++i)
+        {
+            networks.emplace_back(size, 3, &population_memory);
+        }
+    }
+    std::chrono::duration<double, std::milli> arena_time = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::endl << " Setup and teardown of " << population << " graph networks" << std::endl
+              << " Heap : " << heap_time.count() << " ms" << std::endl
+              << " Arena: " << arena_time.count() << " ms" << std::endl;
+
+    // Fitness of a genetic population: one feed forward per network against one pass for every network
+    const size_t candidates = 64;
+
+    std::vector<TiedNeuralNetwork> candidate_networks;
+    std::vector <float > neural_network_desired_output(size);
+    std::vector <float > chromosomes(candidates * PopulationEvaluator::genes);
+    std::vector <float > network_fitness(candidates);
+    std::vector <float > population_fitness(candidates);
+
+    lms_daltonization(img, neural_network_desired_output);
+
+    for (size_t i = 0; i < candidates; ++i)
+    {
+        candidate_networks.emplace_back(size);
+
+        const BinaryData& data = candidate_networks[i].get_binary_data();
+        float* chromosome = &chromosomes[i * PopulationEvaluator::genes];
+
+        chromosome[0] = data.wa;
+        chromosome[1] = data.wb;
+        chromosome[2] = data.wc;
+        chromosome[3] = data.wd;
+        chromosome[4] = data.we;
+        chromosome[5] = data.wf;
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < candidates; ++i)
+    {
+        candidate_networks[i].feed_forward(neural_network_input, kernel_output);
+        network_fitness[i] = calculate_fitness(kernel_output, neural_network_desired_output);
+    }
+    std::chrono::duration<double, std::milli> networks_time = std::chrono::steady_clock::now() - start;
+
+    PopulationEvaluator evaluator;
+
+    start = std::chrono::steady_clock::now();
+    evaluator.evaluate(chromosomes.data(), candidates, neural_network_input.data(), neural_network_desired_output.data(), nullptr, size / 3, population_fitness.data());
+    std::chrono::duration<double, std::milli> population_time = std::chrono::steady_clock::now() - start;
+
+    double largest_difference = 0.0;
+
+    for (size_t i = 0; i < candidates; ++i)
+    {
+        const double difference = std::abs(double(network_fitness[i]) - population_fitness[i]) / std::max(1.0, double(population_fitness[i]));
+        largest_difference = std::max(largest_difference, difference);
+    }
+
+    std::cout << std::endl << " Fitness of " << candidates << " networks" << std::endl
+              << " Per network: " << networks_time.count() << " ms" << std::endl
+              << " Population : " << population_time.count() << " ms (x" << networks_time.count() / population_time.count() << ", "
+              << evaluator.get_throughput() / 1e6 << " Mpixel-candidates/s), largest relative difference " << largest_difference << std::endl;
+
+    std::cout << std::endl << " Activations, fast mode against libm" << std::endl;
+
+    NNFastMath::check_accuracy(std::cout);
+
+    std::cout << std::endl << " Activations, throughput" << std::endl;
+
+    benchmark_activation("exp      ", NNFastMath::exp, -87.f, 88.f);
+    benchmark_activation("sigmoid  ", NNFastMath::sigmoid, -80.f, 80.f);
+    benchmark_activation("tanh     ", NNFastMath::tanh, -80.f, 80.f);
+    benchmark_activation("leakyrelu", NNFastMath::leakyrelu, -80.f, 80.f);
+}
+
+/**
+@brief Measures the throughput of both modes of a batch function
+@param name The name of the function
+@param function The batch function
+@param minimum The minimum value of the measured range
+@param maximum The maximum value of the measured range
+*/
+void NeuralNetworkApplication::benchmark_activation(std::string name, NNFastMath::batch_function function, float minimum, float maximum)
+{
+    const size_t count = 1 << 20;
+    const int repetitions = 10;
+
+    std::vector <float > input(count);
+    std::vector <float > output(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        input[i] = minimum + (maximum - minimum) * float(i) / float(count - 1);
+    }
+
+    double throughput[2];
+    const NNFastMath::modes modes[2] = {NNFastMath::PRECISE, NNFastMath::FAST};
+
+    for (int m = 0; m < 2; ++m)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repetitions; ++i)
+        {
+            function(input.data(), output.data(), count, modes[m]);
+        }
+        std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+        throughput[m] = count * repetitions / time.count() / 1e6;
+    }
+
+    std::cout << " " << name << " [" << minimum << ", " << maximum << "]: precise " << throughput[0] << " Mvalues/s, fast " << throughput[1] << " Mvalues/s" << std::endl;
+}
@@ -0,0 +1,110 @@
+#include <Optimizer.hpp>
+#include <GeneticOptimizer.hpp>
+#include <CmaEsOptimizer.hpp>
+#include <DifferentialEvolutionOptimizer.hpp>
+#include <algorithm>
+
+/**
+@brief Creates an optimizer
+@param strategy The strategy
+@param population The first population, 6 weights per chromosome
+@return The optimizer
+*/
+std::unique_ptr<Optimizer> Optimizer::create(strategies strategy, const std::vector<float>& population)
+{
+    switch (strategy)
+    {
+        case CMA_ES:
+
+            return std::make_unique<CmaEsOptimizer>(population);
+
+        case DIFFERENTIAL_EVOLUTION:
+
+            return std::make_unique<DifferentialEvolutionOptimizer>(population);
+
+        default:
+
+            return std::make_unique<GeneticOptimizer>(population);
+    }
+}
+
+/**
+@brief Gets the strategy of a name given in the command line
+@param name genetic, cmaes or de
+@param strategy The strategy of the name
+@return True if the name is known
+*/
+bool Optimizer::parse_strategy(const std::string& name, strategies& strategy)
+{
+    if (name == "genetic" || name == "ga")
+    {
+        strategy = GENETIC;
+    }
+    else if (name == "cmaes" || name == "cma-es")
+    {
+        strategy = CMA_ES;
+    }
+    else if (name == "de")
+    {
+        strategy = DIFFERENTIAL_EVOLUTION;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+@brief Gives the fitness of the chromosomes of the last ask
+@param chromosomes The chromosomes of the last ask
+@param fitness The fitness of each chromosome. Only the get_selected_count() best need to be exact, the
+others can be lower bounds above them, or the maximum float for the ones not evaluated
+*/
+void Optimizer::tell(const std::vector<float>& chromosomes, const std::vector<float>& fitness)
+{
+    for (size_t i = 0; i < fitness.size(); ++i)
+    {
+        if (fitness[i] < best_fitness)
+        {
+            best_fitness = fitness[i];
+            std::copy(chromosomes.begin() + i * genes, chromosomes.begin() + (i + 1) * genes, best_chromosome.begin());
+        }
+
+        if (fitness[i] < std::numeric_limits<float>::max())
+        {
+            ++evaluations;
+        }
+    }
+
+    update(chromosomes, fitness);
+}
+
+/**
+@brief Writes the state of the optimizer to a checkpoint, between a tell and the next ask
+@param writer The payload of the checkpoint
+*/
+void Optimizer::save(CheckpointWriter& writer) const
+{
+    writer.write(best_chromosome);
+    writer.write(best_fitness);
+    writer.write(evaluations);
+
+    save_state(writer);
+}
+
+/**
+@brief Restores the state written by save. The optimizer must have the strategy and the population size of the
+one saved, the settings are not part of the state
+@param reader The payload of the checkpoint
+@return False if the payload does not hold the state
+*/
+bool Optimizer::load(CheckpointReader& reader)
+{
+    reader.read(best_chromosome);
+    reader.read(best_fitness);
+    reader.read(evaluations);
+
+    return reader.is_valid() && load_state(reader);
+}
@@ -0,0 +1,271 @@
+#include <PixelKernel.hpp>
+#include <NNFastMath.hpp>
+#include <Simd.hpp>
+#include <VectorActivation.hpp>
+
+namespace
+{
+    /**
+    @brief Splits 4 interleaved pixels (12 floats) into one register per component
+    @param input The first value of the 4 pixels
+    @param l The register where the first component is stored
+    @param u The register where the second component is stored
+    @param v The register where the third component is stored
+    */
+    inline void load_pixels(const float* input, __m128& l, __m128& u, __m128& v)
+    {
+        __m128 a = _mm_loadu_ps(input);         // l0 u0 v0 l1
+        __m128 b = _mm_loadu_ps(input + 4);     // u1 v1 l2 u2
+        __m128 c = _mm_loadu_ps(input + 8);     // v2 l3 u3 v3
+
+        l = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 0, 2)), _MM_SHUFFLE(3, 0, 3, 0));
+        u = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 0, 0, 3)), _MM_SHUFFLE(3, 0, 3, 0));
+        v = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 0, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 0, 0)), _MM_SHUFFLE(3, 0, 3, 0));
+    }
+
+    /**
+    @brief Joins one register per component into 4 interleaved pixels (12 floats)
+    @param output The first value of the 4 pixels
+    @param l The register with the first component
+    @param u The register with the second component
+    @param v The register with the third component
+    */
+    inline void store_pixels(float* output, __m128 l, __m128 u, __m128 v)
+    {
+        __m128 lu_low  = _mm_unpacklo_ps(l, u);  // l0 u0 l1 u1
+        __m128 lu_high = _mm_unpackhi_ps(l, u);  // l2 u2 l3 u3
+
+        _mm_storeu_ps(output,     _mm_shuffle_ps(lu_low, _mm_shuffle_ps(v, lu_low, _MM_SHUFFLE(3, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(output + 4, _mm_shuffle_ps(_mm_shuffle_ps(lu_low, v, _MM_SHUFFLE(1, 1, 3, 3)), lu_high, _MM_SHUFFLE(1, 0, 2, 0)));
+        _mm_storeu_ps(output + 8, _mm_shuffle_ps(_mm_shuffle_ps(v, lu_high, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(lu_high, v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+
+    /**
+    @brief Calculates the outputs of a collection of pixels one by one
+    @param weights The hidden weights followed by the output weights
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+    @param pixels The amount of pixels
+    */
+    template <class Hidden, class Output>
+    void run_scalar(const float* weights, const float* input, float* output, float* hidden, size_t pixels)
+    {
+        const float* end = input + pixels * 3;
+
+        while (input < end)
+        {
+            float value = input[0] * weights[0];
+            value += input[1] * weights[1];
+            value += input[2] * weights[2];
+
+            value = Hidden::activate(value);
+
+            output[0] = Output::activate(value * weights[3]);
+            output[1] = Output::activate(value * weights[4]);
+            output[2] = Output::activate(value * weights[5]);
+
+            if (hidden)
+            {
+                (*hidden) = value;
+                ++hidden;
+            }
+
+            input  += 3;
+            output += 3;
+        }
+    }
+
+    /**
+    @brief Calculates the outputs of blocks of 4 pixels with SSE2
+    @param weights The hidden weights followed by the output weights
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+    @param pixels The amount of pixels
+    @return The amount of pixels calculated. The rest must be calculated one by one
+    */
+    template <class Hidden, class Output>
+    size_t run_sse2(const float* weights, const float* input, float* output, float* hidden, size_t pixels)
+    {
+        const size_t blocks = pixels / 4;
+
+        const __m128 wa = _mm_set1_ps(weights[0]);
+        const __m128 wb = _mm_set1_ps(weights[1]);
+        const __m128 wc = _mm_set1_ps(weights[2]);
+        const __m128 wd = _mm_set1_ps(weights[3]);
+        const __m128 we = _mm_set1_ps(weights[4]);
+        const __m128 wf = _mm_set1_ps(weights[5]);
+
+        for (size_t block = 0; block < blocks; ++block)
+        {
+            __m128 l, u, v;
+            load_pixels(input, l, u, v);
+
+            __m128 value = _mm_mul_ps(l, wa);
+            value = _mm_add_ps(value, _mm_mul_ps(u, wb));
+            value = _mm_add_ps(value, _mm_mul_ps(v, wc));
+
+            value = VectorActivation<Hidden>::sse2(value);
+
+            if (hidden)
+            {
+                _mm_storeu_ps(hidden, value);
+                hidden += 4;
+            }
+
+            store_pixels    (
+                                output,
+                                VectorActivation<Output>::sse2(_mm_mul_ps(value, wd)),
+                                VectorActivation<Output>::sse2(_mm_mul_ps(value, we)),
+                                VectorActivation<Output>::sse2(_mm_mul_ps(value, wf))
+                            );
+
+            input  += 12;
+            output += 12;
+        }
+
+        return blocks * 4;
+    }
+
+    /**
+    @brief Calculates the outputs of blocks of 8 pixels with AVX2
+    @param weights The hidden weights followed by the output weights
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+    @param pixels The amount of pixels
+    @return The amount of pixels calculated. The rest must be calculated one by one
+    */
+    template <class Hidden, class Output>
+    NN_TARGET_AVX2 size_t run_avx2(const float* weights, const float* input, float* output, float* hidden, size_t pixels)
+    {
+        const size_t blocks = pixels / 8;
+
+        const __m256 wa = _mm256_set1_ps(weights[0]);
+        const __m256 wb = _mm256_set1_ps(weights[1]);
+        const __m256 wc = _mm256_set1_ps(weights[2]);
+        const __m256 wd = _mm256_set1_ps(weights[3]);
+        const __m256 we = _mm256_set1_ps(weights[4]);
+        const __m256 wf = _mm256_set1_ps(weights[5]);
+
+        for (size_t block = 0; block < blocks; ++block)
+        {
+            // De-interleave the 8 pixels as two halves of 4
+            __m128 l_low, u_low, v_low, l_high, u_high, v_high;
+            load_pixels(input,      l_low,  u_low,  v_low);
+            load_pixels(input + 12, l_high, u_high, v_high);
+
+            __m256 l = _mm256_insertf128_ps(_mm256_castps128_ps256(l_low), l_high, 1);
+            __m256 u = _mm256_insertf128_ps(_mm256_castps128_ps256(u_low), u_high, 1);
+            __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(v_low), v_high, 1);
+
+            __m256 value = _mm256_mul_ps(l, wa);
+            value = _mm256_add_ps(value, _mm256_mul_ps(u, wb));
+            value = _mm256_add_ps(value, _mm256_mul_ps(v, wc));
+
+            value = VectorActivation<Hidden>::avx2(value);
+
+            if (hidden)
+            {
+                _mm256_storeu_ps(hidden, value);
+                hidden += 8;
+            }
+
+            __m256 out_l = VectorActivation<Output>::avx2(_mm256_mul_ps(value, wd));
+            __m256 out_u = VectorActivation<Output>::avx2(_mm256_mul_ps(value, we));
+            __m256 out_v = VectorActivation<Output>::avx2(_mm256_mul_ps(value, wf));
+
+            store_pixels(output,      _mm256_castps256_ps128(out_l), _mm256_castps256_ps128(out_u), _mm256_castps256_ps128(out_v));
+            store_pixels(output + 12, _mm256_extractf128_ps(out_l, 1), _mm256_extractf128_ps(out_u, 1), _mm256_extractf128_ps(out_v, 1));
+
+            input  += 24;
+            output += 24;
+        }
+
+        return blocks * 8;
+    }
+}
+
+/**
+@brief Compiles the kernel of a network
+@param data The tied weights of the network
+@param hidden_activation The activation of the hidden layer
+@param output_activation The activation of the output layer
+@param mode The precision of the activations
+*/
+PixelKernel::PixelKernel(const BinaryData& data, NNActivations::activations hidden_activation, NNActivations::activations output_activation, NNFastMath::modes mode)
+    :
+    hidden_weights {data.wa, data.wb, data.wc},
+    output_weights {data.wd, data.we, data.wf}
+{
+    const Simd::instruction_sets set = Simd::get_instruction_set();
+
+    NNFastMath::dispatch(hidden_activation, mode, [&](auto hidden)
+    {
+        NNFastMath::dispatch(output_activation, mode, [&](auto output)
+        {
+            typedef decltype(hidden) Hidden;
+            typedef decltype(output) Output;
+
+            scalar_runner = &run_pixels<Hidden, Output, Simd::SCALAR>;
+
+            if (VectorActivation<Hidden>::vectorizable && VectorActivation<Output>::vectorizable)
+            {
+                runner = set == Simd::AVX2 ? &run_pixels<Hidden, Output, Simd::AVX2> :
+                         set == Simd::SSE2 ? &run_pixels<Hidden, Output, Simd::SSE2> :
+                                       &run_pixels<Hidden, Output, Simd::SCALAR>;
+            }
+            else
+            {
+                runner = &run_pixels<Hidden, Output, Simd::SCALAR>;
+            }
+        });
+    });
+}
+
+/**
+@brief Calculates the outputs of a collection of pixels splitting them in chunks between the threads of a pool
+@param input The first input value. Three values per pixel
+@param output The first output value. Three values per pixel
+@param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+@param pixels The amount of pixels
+@param pool The threads
+*/
+void PixelKernel::run(const float* input, float* output, float* hidden, size_t pixels, ThreadPool& pool) const
+{
+    pool.parallel_for(pixels, [&](size_t /*chunk*/, size_t begin, size_t end)
+    {
+        runner(*this, input + begin * 3, output + begin * 3, hidden ? hidden + begin : nullptr, end - begin);
+    });
+}
+
+/**
+@brief Calculates the outputs of a collection of pixels with the given instruction set, the pixels that
+do not fill a vector are calculated one by one
+@param kernel The kernel with the weights
+@param input The first input value. Three values per pixel
+@param output The first output value. Three values per pixel
+@param hidden The first hidden value. One value per pixel, nullptr if they must not be kept
+@param pixels The amount of pixels
+*/
+template <class Hidden, class Output, Simd::instruction_sets set>
+void PixelKernel::run_pixels(const PixelKernel& kernel, const float* input, float* output, float* hidden, size_t pixels)
+{
+    const float weights[6] =    {
+                                    kernel.hidden_weights[0], kernel.hidden_weights[1], kernel.hidden_weights[2],
+                                    kernel.output_weights[0], kernel.output_weights[1], kernel.output_weights[2]
+                                };
+    size_t done = 0;
+
+    if constexpr (set == Simd::AVX2 && VectorActivation<Hidden>::vectorizable && VectorActivation<Output>::vectorizable)
+    {
+        done = run_avx2<Hidden, Output>(weights, input, output, hidden, pixels);
+    }
+    else if constexpr (set == Simd::SSE2 && VectorActivation<Hidden>::vectorizable && VectorActivation<Output>::vectorizable)
+    {
+        done = run_sse2<Hidden, Output>(weights, input, output, hidden, pixels);
+    }
+
+    run_scalar<Hidden, Output>(weights, input + done * 3, output + done * 3, hidden ? hidden + done : nullptr, pixels - done);
+}
@@ -0,0 +1,265 @@
+#include <PopulationEvaluator.hpp>
+#include <ThreadPool.hpp>
+#include <VectorActivation.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    /**
+    @brief Calculates the delta of a pixel of a candidate. Same operations as the per pixel kernel
+    @param weights The 6 weights of the candidate
+    @param components The block split in component arrays
+    @param index The index of the pixel in the block
+    @return The LUV delta of the pixel times the amount of pixels it stands for
+    */
+    template <class Hidden, class Output>
+    float pixel_delta(const float* weights, const float* components, size_t index)
+    {
+        const size_t block = PopulationEvaluator::block_pixels;
+
+        float value = components[index] * weights[0];
+        value += components[block + index] * weights[1];
+        value += components[2 * block + index] * weights[2];
+        value = Hidden::activate(value);
+
+        const float l = components[3 * block + index] - Output::activate(value * weights[3]);
+        const float u = components[4 * block + index] - Output::activate(value * weights[4]);
+        const float v = components[5 * block + index] - Output::activate(value * weights[5]);
+
+        return components[6 * block + index] * sqrtf(l * l + u * u + v * v);
+    }
+
+    template <class Hidden, class Output>
+    void block_scalar(const float* chromosomes, size_t candidates, const float* components, size_t pixels, double* fitness)
+    {
+        for (size_t c = 0; c < candidates; ++c)
+        {
+            const float* weights = chromosomes + c * PopulationEvaluator::genes;
+            float sum = 0.f;
+
+            for (size_t i = 0; i < pixels; ++i)
+            {
+                sum += pixel_delta<Hidden, Output>(weights, components, i);
+            }
+
+            fitness[c] += sum;
+        }
+    }
+
+    template <class Hidden, class Output>
+    void block_sse2(const float* chromosomes, size_t candidates, const float* components, size_t pixels, double* fitness)
+    {
+        const size_t block = PopulationEvaluator::block_pixels;
+
+        for (size_t c = 0; c < candidates; ++c)
+        {
+            const float* weights = chromosomes + c * PopulationEvaluator::genes;
+
+            const __m128 wa = _mm_set1_ps(weights[0]);
+            const __m128 wb = _mm_set1_ps(weights[1]);
+            const __m128 wc = _mm_set1_ps(weights[2]);
+            const __m128 wd = _mm_set1_ps(weights[3]);
+            const __m128 we = _mm_set1_ps(weights[4]);
+            const __m128 wf = _mm_set1_ps(weights[5]);
+
+            __m128 sums = _mm_setzero_ps();
+            size_t i = 0;
+
+            for (; i + 4 <= pixels; i += 4)
+            {
+                __m128 value = _mm_mul_ps(_mm_load_ps(components + i), wa);
+                value = _mm_add_ps(value, _mm_mul_ps(_mm_load_ps(components + block + i), wb));
+                value = _mm_add_ps(value, _mm_mul_ps(_mm_load_ps(components + 2 * block + i), wc));
+                value = VectorActivation<Hidden>::sse2(value);
+
+                __m128 l = _mm_sub_ps(_mm_load_ps(components + 3 * block + i), VectorActivation<Output>::sse2(_mm_mul_ps(value, wd)));
+                __m128 u = _mm_sub_ps(_mm_load_ps(components + 4 * block + i), VectorActivation<Output>::sse2(_mm_mul_ps(value, we)));
+                __m128 v = _mm_sub_ps(_mm_load_ps(components + 5 * block + i), VectorActivation<Output>::sse2(_mm_mul_ps(value, wf)));
+
+                __m128 delta = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(l, l), _mm_mul_ps(u, u)), _mm_mul_ps(v, v)));
+                sums = _mm_add_ps(sums, _mm_mul_ps(_mm_load_ps(components + 6 * block + i), delta));
+            }
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, sums);
+
+            float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+            for (; i < pixels; ++i)
+            {
+                sum += pixel_delta<Hidden, Output>(weights, components, i);
+            }
+
+            fitness[c] += sum;
+        }
+    }
+
+    template <class Hidden, class Output>
+    NN_TARGET_AVX2 void block_avx2(const float* chromosomes, size_t candidates, const float* components, size_t pixels, double* fitness)
+    {
+        const size_t block = PopulationEvaluator::block_pixels;
+
+        for (size_t c = 0; c < candidates; ++c)
+        {
+            const float* weights = chromosomes + c * PopulationEvaluator::genes;
+
+            const __m256 wa = _mm256_set1_ps(weights[0]);
+            const __m256 wb = _mm256_set1_ps(weights[1]);
+            const __m256 wc = _mm256_set1_ps(weights[2]);
+            const __m256 wd = _mm256_set1_ps(weights[3]);
+            const __m256 we = _mm256_set1_ps(weights[4]);
+            const __m256 wf = _mm256_set1_ps(weights[5]);
+
+            __m256 sums = _mm256_setzero_ps();
+            size_t i = 0;
+
+            for (; i + 8 <= pixels; i += 8)
+            {
+                __m256 value = _mm256_mul_ps(_mm256_load_ps(components + i), wa);
+                value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_load_ps(components + block + i), wb));
+                value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_load_ps(components + 2 * block + i), wc));
+                value = VectorActivation<Hidden>::avx2(value);
+
+                __m256 l = _mm256_sub_ps(_mm256_load_ps(components + 3 * block + i), VectorActivation<Output>::avx2(_mm256_mul_ps(value, wd)));
+                __m256 u = _mm256_sub_ps(_mm256_load_ps(components + 4 * block + i), VectorActivation<Output>::avx2(_mm256_mul_ps(value, we)));
+                __m256 v = _mm256_sub_ps(_mm256_load_ps(components + 5 * block + i), VectorActivation<Output>::avx2(_mm256_mul_ps(value, wf)));
+
+                __m256 delta = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(l, l), _mm256_mul_ps(u, u)), _mm256_mul_ps(v, v)));
+                sums = _mm256_add_ps(sums, _mm256_mul_ps(_mm256_load_ps(components + 6 * block + i), delta));
+            }
+
+            float lanes[8];
+            _mm256_storeu_ps(lanes, sums);
+
+            float sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+
+            for (; i < pixels; ++i)
+            {
+                sum += pixel_delta<Hidden, Output>(weights, components, i);
+            }
+
+            fitness[c] += sum;
+        }
+    }
+}
+
+/**
+@brief Creates an evaluator for networks with the given activations
+@param hidden_activation The activation of the hidden layer
+@param output_activation The activation of the output layer
+@param mode The precision of the activations
+*/
+PopulationEvaluator::PopulationEvaluator(NNActivations::activations hidden_activation, NNActivations::activations output_activation, NNFastMath::modes mode)
+{
+    const Simd::instruction_sets set = Simd::get_instruction_set();
+
+    NNFastMath::dispatch(hidden_activation, mode, [&](auto hidden)
+    {
+        NNFastMath::dispatch(output_activation, mode, [&](auto output)
+        {
+            typedef decltype(hidden) Hidden;
+            typedef decltype(output) Output;
+
+            if (VectorActivation<Hidden>::vectorizable && VectorActivation<Output>::vectorizable)
+            {
+                block_runner = set == Simd::AVX2 ? &run_block<Hidden, Output, Simd::AVX2> :
+                               set == Simd::SSE2 ? &run_block<Hidden, Output, Simd::SSE2> :
+                                                   &run_block<Hidden, Output, Simd::SCALAR>;
+            }
+            else
+            {
+                block_runner = &run_block<Hidden, Output, Simd::SCALAR>;
+            }
+        });
+    });
+}
+
+/**
+@brief Calculates the fitness of every candidate: the sum over the pixels of the LUV delta between the output of
+the candidate and the desired values
+@param chromosomes The first weight of the matrix. 6 weights per candidate
+@param candidates The amount of candidates
+@param input The first input value. Three values per pixel
+@param desired The first desired value. Three values per pixel
+@param counts The amount of pixels each pixel stands for, as in a colour table. nullptr for one each
+@param pixels The amount of pixels
+@param fitness The first fitness. One per candidate
+*/
+void PopulationEvaluator::evaluate(const float* chromosomes, size_t candidates, const float* input, const float* desired, const float* counts, size_t pixels, float* fitness)
+{
+    // An image that could not be decoded has no pixels
+    if (pixels == 0)
+    {
+        std::fill(fitness, fitness + candidates, 0.f);
+
+        last_seconds = 0.0;
+        last_pixel_candidates = 0.0;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<double>> partials(ThreadPool::get_chunks_count(pixels), std::vector<double>(candidates, 0.0));
+
+    ThreadPool::get().parallel_for(pixels, [&](size_t chunk, size_t begin, size_t end)
+    {
+        alignas(64) float components[7 * block_pixels];
+
+        for (size_t first = begin; first < end; first += block_pixels)
+        {
+            const size_t count = end - first < block_pixels ? end - first : block_pixels;
+            const float* block_input = input + first * 3;
+            const float* block_desired = desired + first * 3;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                components[i]                    = block_input[i * 3];
+                components[block_pixels + i]     = block_input[i * 3 + 1];
+                components[2 * block_pixels + i] = block_input[i * 3 + 2];
+                components[3 * block_pixels + i] = block_desired[i * 3];
+                components[4 * block_pixels + i] = block_desired[i * 3 + 1];
+                components[5 * block_pixels + i] = block_desired[i * 3 + 2];
+                components[6 * block_pixels + i] = counts != nullptr ? counts[first + i] : 1.f;
+            }
+
+            block_runner(chromosomes, candidates, components, count, partials[chunk].data());
+        }
+    });
+
+    const std::vector<double> sums = ThreadPool::tree_reduce(partials, candidates);
+
+    for (size_t c = 0; c < candidates; ++c)
+    {
+        fitness[c] = float(sums[c]);
+    }
+
+    last_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    last_pixel_candidates = double(pixels) * candidates;
+}
+
+/**
+@brief Adds the deltas of a block of pixels to the fitness of every candidate
+@param chromosomes The first weight of the matrix. 6 weights per candidate
+@param candidates The amount of candidates
+@param components The block split in 7 arrays of block_pixels values: l, u, v, the desired l, u, v and the counts
+@param pixels The amount of pixels of the block
+@param fitness The first fitness. One per candidate
+*/
+template <class Hidden, class Output, Simd::instruction_sets set>
+void PopulationEvaluator::run_block(const float* chromosomes, size_t candidates, const float* components, size_t pixels, double* fitness)
+{
+    if constexpr (set == Simd::AVX2 && VectorActivation<Hidden>::vectorizable && VectorActivation<Output>::vectorizable)
+    {
+        block_avx2<Hidden, Output>(chromosomes, candidates, components, pixels, fitness);
+    }
+    else if constexpr (set == Simd::SSE2 && VectorActivation<Hidden>::vectorizable && VectorActivation<Output>::vectorizable)
+    {
+        block_sse2<Hidden, Output>(chromosomes, candidates, components, pixels, fitness);
+    }
+    else
+    {
+        block_scalar<Hidden, Output>(chromosomes, candidates, components, pixels, fitness);
+    }
+}
@@ -0,0 +1,216 @@
+#include <ProgressiveEvaluator.hpp>
+#include <algorithm>
+#include <limits>
+
+/**
+@brief Builds the pyramid of an image
+@param histogram The colour table of the image
+*/
+void ProgressiveEvaluator::set_image(const ColorHistogram& histogram)
+{
+    const size_t colors = histogram.get_colors_count();
+
+    std::array<size_t, levels> level_counts {};
+
+    for (size_t i = 0; i < colors; ++i)
+    {
+        ++level_counts[get_level(i)];
+    }
+
+    level_first[0] = 0;
+
+    for (size_t level = 0; level < levels; ++level)
+    {
+        level_first[level + 1] = level_first[level] + level_counts[level];
+    }
+
+    input.resize(colors * 3);
+    desired.resize(colors * 3);
+    counts.resize(colors);
+
+    std::array<size_t, levels> next;
+    std::copy(level_first.begin(), level_first.begin() + levels, next.begin());
+
+    for (size_t i = 0; i < colors; ++i)
+    {
+        const size_t target = next[get_level(i)]++;
+
+        for (size_t k = 0; k < 3; ++k)
+        {
+            input[target * 3 + k] = histogram.get_input()[i * 3 + k];
+            desired[target * 3 + k] = histogram.get_desired()[i * 3 + k];
+        }
+
+        counts[target] = histogram.get_counts()[i];
+    }
+
+    level_weight[0] = 0.0;
+
+    for (size_t level = 0; level < levels; ++level)
+    {
+        double weight = 0.0;
+
+        for (size_t i = level_first[level]; i < level_first[level + 1]; ++i)
+        {
+            weight += counts[i];
+        }
+
+        level_weight[level + 1] = level_weight[level] + weight;
+    }
+}
+
+/**
+@brief Scores a population. The candidates that can not be in the k best get a lower bound of their fitness
+@param chromosomes The first weight of the matrix. 6 weights per candidate
+@param candidates The amount of candidates
+@param selected k, the amount of best candidates that must be exact
+@param known The fitness values known before the evaluation that compete for the selection, for example of
+the cached candidates
+@param fitness The first fitness. One per candidate
+@param complete Set to 1 for the candidates fully scored and 0 for the rejected ones
+*/
+void ProgressiveEvaluator::evaluate(const float* chromosomes, size_t candidates, size_t selected, const std::vector<float>& known, float* fitness, std::vector<uint8_t>& complete)
+{
+    const size_t colors = level_first[levels];
+
+    totals.assign(candidates, 0.0);
+    complete.assign(candidates, 0);
+    estimates.resize(candidates);
+
+    statistics.candidates += candidates;
+    statistics.full_pixel_candidates += uint64_t(candidates) * colors;
+
+    best_values.clear();
+
+    auto add_value = [&](float value)
+    {
+        if (selected == 0 || (best_values.size() == selected && !(value < best_values.back())))
+        {
+            return;
+        }
+
+        best_values.insert(std::upper_bound(best_values.begin(), best_values.end(), value), value);
+
+        if (best_values.size() > selected)
+        {
+            best_values.pop_back();
+        }
+    };
+
+    auto get_threshold = [&]()
+    {
+        return selected > 0 && best_values.size() == selected ? best_values.back() : std::numeric_limits<float>::max();
+    };
+
+    for (float value : known)
+    {
+        add_value(value);
+    }
+
+    auto add_complete = [&](size_t candidate)
+    {
+        const float value = float(totals[candidate]);
+
+        fitness[candidate] = value;
+        estimates[candidate] = value;
+        complete[candidate] = 1;
+
+        add_value(value);
+    };
+
+    // The coarsest level for everyone
+    alive.resize(candidates);
+
+    for (size_t candidate = 0; candidate < candidates; ++candidate)
+    {
+        alive[candidate] = candidate;
+    }
+
+    score_level(chromosomes, 0);
+
+    // The k most promising candidates are completed first, their fitness is the first rejection threshold
+    std::stable_sort(alive.begin(), alive.end(), [&](size_t a, size_t b) { return totals[a] < totals[b]; });
+
+    const size_t first_completed = std::min(std::max<size_t>(selected, 1), alive.size());
+
+    std::vector<size_t> rest(alive.begin() + first_completed, alive.end());
+    alive.resize(first_completed);
+
+    for (size_t level = 1; level < levels; ++level)
+    {
+        score_level(chromosomes, level);
+    }
+
+    for (size_t candidate : alive)
+    {
+        add_complete(candidate);
+    }
+
+    // The bound only grows, so a candidate above the k-th best fitness can not be selected
+    alive.swap(rest);
+
+    auto reject = [&](size_t level)
+    {
+        const float threshold = get_threshold();
+        const double scale = level_weight[level] > 0.0 ? level_weight[levels] / level_weight[level] : 1.0;
+
+        auto end = std::remove_if(alive.begin(), alive.end(), [&](size_t candidate)
+        {
+            if (float(totals[candidate]) > threshold)
+            {
+                fitness[candidate] = float(totals[candidate]);
+                estimates[candidate] = float(totals[candidate] * scale);
+                ++statistics.rejected;
+                return true;
+            }
+
+            return false;
+        });
+
+        alive.erase(end, alive.end());
+    };
+
+    for (size_t level = 1; level < levels; ++level)
+    {
+        reject(level);
+        score_level(chromosomes, level);
+    }
+
+    for (size_t candidate : alive)
+    {
+        add_complete(candidate);
+    }
+}
+
+/**
+@brief Scores the alive candidates on a level and adds the result to their totals
+@param chromosomes The first weight of the matrix of all the candidates
+@param level The level
+*/
+void ProgressiveEvaluator::score_level(const float* chromosomes, size_t level)
+{
+    const size_t first = level_first[level];
+    const size_t count = level_first[level + 1] - first;
+
+    if (alive.empty() || count == 0)
+    {
+        return;
+    }
+
+    rows.resize(alive.size() * PopulationEvaluator::genes);
+    level_fitness.resize(alive.size());
+
+    for (size_t i = 0; i < alive.size(); ++i)
+    {
+        std::copy(chromosomes + alive[i] * PopulationEvaluator::genes, chromosomes + (alive[i] + 1) * PopulationEvaluator::genes, rows.begin() + i * PopulationEvaluator::genes);
+    }
+
+    evaluator.evaluate(rows.data(), alive.size(), input.data() + first * 3, desired.data() + first * 3, counts.data() + first, count, level_fitness.data());
+
+    for (size_t i = 0; i < alive.size(); ++i)
+    {
+        totals[alive[i]] += level_fitness[i];
+    }
+
+    statistics.pixel_candidates += uint64_t(alive.size()) * count;
+}
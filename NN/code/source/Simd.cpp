@@ -0,0 +1,43 @@
+#include <Simd.hpp>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+/**
+@brief Gets the widest instruction set supported by the processor. Detected once
+@return The instruction set
+*/
+Simd::instruction_sets Simd::get_instruction_set()
+{
+    static const instruction_sets detected = []()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+
+        __cpuid(info, 1);
+        bool os_saves_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6);
+
+        if (os_saves_avx && max_leaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+            {
+                return AVX2;
+            }
+        }
+
+        return SSE2;
+#else
+        __builtin_cpu_init();
+
+        return __builtin_cpu_supports("avx2") ? AVX2 :
+               __builtin_cpu_supports("sse2") ? SSE2 :
+                                                SCALAR;
+#endif
+    }();
+
+    return detected;
+}
@@ -0,0 +1,321 @@
+#include <SurrogateModel.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+/**
+@brief Forgets the evaluations, for example when the image changes. The counters are kept
+*/
+void SurrogateModel::clear()
+{
+    samples.clear();
+    values.clear();
+    predictions.clear();
+    next = 0;
+    fitted = false;
+}
+
+/**
+@brief Predicts the fitness of a chromosome. The model must be ready
+@param chromosome The 6 weights
+@return The predicted fitness
+*/
+float SurrogateModel::predict(const float* chromosome)
+{
+    if (!fitted)
+    {
+        fit();
+    }
+
+    double x[features];
+    get_features(chromosome, x);
+
+    double value = 0.0;
+
+    for (size_t i = 0; i < features; ++i)
+    {
+        value += coefficients[i] * x[i];
+    }
+
+    // The fitted values are log(1 + fitness)
+    return float(std::expm1(std::min(value, 80.0)));
+}
+
+/**
+@brief Keeps the most promising chromosomes of a batch. While the model is not ready every chromosome is kept
+@param chromosomes The first weight of the matrix. 6 weights per chromosome
+@param count The amount of chromosomes
+@param kept The amount of chromosomes to keep
+@param screened Filled with the kept chromosomes, in the order of the batch
+@param indices Filled with the index in the batch of every kept chromosome
+@return The amount of chromosomes kept
+*/
+size_t SurrogateModel::screen(const float* chromosomes, size_t count, size_t kept, std::vector<float>& screened, std::vector<size_t>& indices)
+{
+    const bool ready = is_ready();
+
+    if (!ready || kept > count)
+    {
+        kept = count;
+    }
+
+    indices.resize(count);
+    std::iota(indices.begin(), indices.end(), size_t(0));
+
+    std::vector<float> all_predictions(ready ? count : 0);
+
+    if (ready)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            all_predictions[i] = predict(chromosomes + i * genes);
+        }
+
+        std::partial_sort(indices.begin(), indices.begin() + kept, indices.end(), [&](size_t a, size_t b) { return all_predictions[a] < all_predictions[b]; });
+
+        indices.resize(kept);
+        std::sort(indices.begin(), indices.end());
+
+        statistics.proposed += count;
+        statistics.screened_out += count - kept;
+    }
+
+    screened.resize(kept * genes);
+    predictions.assign(kept, 0.f);
+
+    for (size_t i = 0; i < kept; ++i)
+    {
+        std::copy(chromosomes + indices[i] * genes, chromosomes + (indices[i] + 1) * genes, screened.begin() + i * genes);
+
+        if (ready)
+        {
+            predictions[i] = all_predictions[indices[i]];
+        }
+    }
+
+    return kept;
+}
+
+/**
+@brief Adds the evaluations of the chromosomes of the last screen and measures the error of their predictions
+@param screened The chromosomes of the last screen
+@param fitness The fitness of each one, or an estimate as ProgressiveEvaluator::get_estimates gives
+@param count The amount of chromosomes
+*/
+void SurrogateModel::learn(const float* screened, const float* fitness, size_t count)
+{
+    double error_sum = 0.0;
+    uint64_t errors = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        // The weights far out of range overflow the fitness
+        if (!std::isfinite(fitness[i]))
+        {
+            continue;
+        }
+
+        if (i < predictions.size() && predictions[i] > 0.f && fitness[i] > 0.f)
+        {
+            error_sum += std::fabs(double(predictions[i]) - fitness[i]) / fitness[i];
+            ++errors;
+        }
+
+        std::array<float, genes> sample;
+        std::copy(screened + i * genes, screened + (i + 1) * genes, sample.begin());
+
+        if (samples.size() < capacity)
+        {
+            samples.push_back(sample);
+            values.push_back(float(std::log1p(std::max(0.f, fitness[i]))));
+        }
+        else
+        {
+            samples[next] = sample;
+            values[next] = float(std::log1p(std::max(0.f, fitness[i])));
+            next = (next + 1) % capacity;
+        }
+
+        fitted = false;
+    }
+
+    statistics.predictions += errors;
+    statistics.error_sum += error_sum;
+
+    if (errors > 0)
+    {
+        statistics.last_error = error_sum / errors;
+    }
+
+    predictions.clear();
+}
+
+/**
+@brief Writes the evaluations kept to a checkpoint. The fit is computed again from them
+@param writer The payload of the checkpoint
+*/
+void SurrogateModel::save(CheckpointWriter& writer) const
+{
+    writer.write_vector(samples);
+    writer.write_vector(values);
+    writer.write(uint64_t(next));
+}
+
+/**
+@brief Restores the evaluations written by save
+@param reader The payload of the checkpoint
+@return False if the payload does not hold the evaluations
+*/
+bool SurrogateModel::load(CheckpointReader& reader)
+{
+    uint64_t saved_next = 0;
+
+    clear();
+
+    reader.read_vector(samples);
+    reader.read_vector(values);
+    reader.read(saved_next);
+
+    if (!reader.is_valid() || samples.size() != values.size() || samples.size() > capacity || saved_next >= capacity)
+    {
+        clear();
+        return false;
+    }
+
+    next = size_t(saved_next);
+
+    return true;
+}
+
+/**
+@brief Solves the ridge regression of the evaluations kept
+*/
+void SurrogateModel::fit()
+{
+    // Standardized weights, the products of raw weights of a narrow population are almost collinear
+    for (size_t gene = 0; gene < genes; ++gene)
+    {
+        double sum = 0.0;
+        double square_sum = 0.0;
+
+        for (const auto& sample : samples)
+        {
+            sum += sample[gene];
+            square_sum += double(sample[gene]) * sample[gene];
+        }
+
+        center[gene] = sum / samples.size();
+
+        const double variance = square_sum / samples.size() - center[gene] * center[gene];
+        scale[gene] = variance > 1e-12 ? 1.0 / std::sqrt(variance) : 1.0;
+    }
+
+    // Normal equations (X^T X + ridge) c = X^T y
+    std::vector<double> gram(features * features, 0.0);
+    std::array<double, features> right {};
+    double x[features];
+
+    for (size_t s = 0; s < samples.size(); ++s)
+    {
+        get_features(samples[s].data(), x);
+
+        for (size_t i = 0; i < features; ++i)
+        {
+            right[i] += x[i] * values[s];
+
+            for (size_t j = 0; j <= i; ++j)
+            {
+                gram[i * features + j] += x[i] * x[j];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < features; ++i)
+    {
+        gram[i * features + i] += ridge * gram[i * features + i] + 1e-9;
+    }
+
+    // Cholesky factor in the lower triangle
+    for (size_t j = 0; j < features; ++j)
+    {
+        double diagonal = gram[j * features + j];
+
+        for (size_t k = 0; k < j; ++k)
+        {
+            diagonal -= gram[j * features + k] * gram[j * features + k];
+        }
+
+        gram[j * features + j] = std::sqrt(std::max(diagonal, 1e-12));
+
+        for (size_t i = j + 1; i < features; ++i)
+        {
+            double value = gram[i * features + j];
+
+            for (size_t k = 0; k < j; ++k)
+            {
+                value -= gram[i * features + k] * gram[j * features + k];
+            }
+
+            gram[i * features + j] = value / gram[j * features + j];
+        }
+    }
+
+    // L z = X^T y and L^T c = z
+    for (size_t i = 0; i < features; ++i)
+    {
+        double value = right[i];
+
+        for (size_t k = 0; k < i; ++k)
+        {
+            value -= gram[i * features + k] * coefficients[k];
+        }
+
+        coefficients[i] = value / gram[i * features + i];
+    }
+
+    for (size_t i = features; i-- > 0;)
+    {
+        double value = coefficients[i];
+
+        for (size_t k = i + 1; k < features; ++k)
+        {
+            value -= gram[k * features + i] * coefficients[k];
+        }
+
+        coefficients[i] = value / gram[i * features + i];
+    }
+
+    fitted = true;
+}
+
+/**
+@brief Gets the features of a chromosome
+@param chromosome The 6 weights
+@param values The 28 features
+*/
+void SurrogateModel::get_features(const float* chromosome, double* values) const
+{
+    double x[genes];
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        x[i] = (chromosome[i] - center[i]) * scale[i];
+    }
+
+    size_t feature = 0;
+
+    values[feature++] = 1.0;
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        values[feature++] = x[i];
+    }
+
+    for (size_t i = 0; i < genes; ++i)
+    {
+        for (size_t j = i; j < genes; ++j)
+        {
+            values[feature++] = x[i] * x[j];
+        }
+    }
+}
@@ -0,0 +1,255 @@
+#include <ThreadPool.hpp>
+
+thread_local const ThreadPool* ThreadPool::worker_pool = nullptr;
+thread_local size_t ThreadPool::worker_queue = 0;
+
+/**
+@brief Creates a pool. The calling thread also runs tasks, so threads_count - 1 workers are created
+@param threads_count The amount of threads that run the tasks, 0 for all the hardware threads
+*/
+ThreadPool::ThreadPool(size_t threads_count)
+{
+    start(threads_count);
+}
+
+/**
+@brief Stops the workers
+*/
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+/**
+@brief Changes the amount of threads. Must not be called while a run is in progress
+@param threads_count The amount of threads that run the tasks, 0 for all the hardware threads
+*/
+void ThreadPool::set_threads_count(size_t threads_count)
+{
+    stop();
+    start(threads_count);
+}
+
+/**
+@brief Runs a task for each index in [0, tasks) and waits until all of them finish. If a task throws, the tasks
+not started yet are skipped and the first exception is thrown once the started ones finish
+@param tasks The amount of tasks
+@param function The task, called with the task index
+*/
+void ThreadPool::run(size_t tasks, const std::function<void(size_t)>& function)
+{
+    // Not worth waking the workers
+    if (tasks <= 1 || workers.empty())
+    {
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            function(i);
+        }
+
+        return;
+    }
+
+    Job job;
+    job.function = &function;
+    job.count = tasks;
+    job.finished = 0;
+    job.failed = false;
+
+    const size_t queue = get_queue();
+
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            queues[queue]->tasks.push_back({&job, i});
+        }
+    }
+
+    queued += tasks;
+
+    // The sleeping threads check the queued tasks with the mutex locked, so they are either awake or already waiting
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    work_condition.notify_all();
+
+    // Take the own tasks first and then steal from the other runs until the last own task finishes. With nothing
+    // to take, the thread sleeps until tasks are pushed or the last own task finishes
+    while (job.finished.load(std::memory_order_acquire) != tasks)
+    {
+        Task task;
+
+        if (take_task(queue, task))
+        {
+            execute(task);
+        }
+        else
+        {
+            wait_for_tasks([&]() { return job.finished.load(std::memory_order_acquire) == tasks; });
+        }
+    }
+
+    if (job.error)
+    {
+        std::rethrow_exception(job.error);
+    }
+}
+
+/**
+@brief Creates the workers
+@param threads_count The amount of threads that run the tasks, 0 for all the hardware threads
+*/
+void ThreadPool::start(size_t threads_count)
+{
+    if (threads_count == 0)
+    {
+        threads_count = std::thread::hardware_concurrency();
+    }
+
+    if (threads_count == 0)
+    {
+        threads_count = 1;
+    }
+
+    stopping = false;
+
+    queues.clear();
+
+    for (size_t i = 0; i < threads_count; ++i)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 1; i < threads_count; ++i)
+    {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+/**
+@brief Stops and joins the workers
+*/
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    work_condition.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    workers.clear();
+}
+
+/**
+@brief Loop of a worker thread, takes and steals tasks and sleeps when there are none
+@param queue The queue of the worker
+*/
+void ThreadPool::work(size_t queue)
+{
+    worker_pool = this;
+    worker_queue = queue;
+
+    while (true)
+    {
+        Task task;
+
+        if (take_task(queue, task))
+        {
+            execute(task);
+        }
+        else if (wait_for_tasks([]() { return false; }))
+        {
+            return;
+        }
+    }
+}
+
+/**
+@brief Takes a task from the back of a queue of the calling thread or else steals one from the front of
+the other queues, starting with the next one
+@param queue The queue of the calling thread
+@param task The task taken
+@return True if a task was taken
+*/
+bool ThreadPool::take_task(size_t queue, Task& task)
+{
+    if (queued.load() == 0)
+    {
+        return false;
+    }
+
+    {
+        Queue& own = *queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+
+    for (size_t k = 1; k < queues.size(); ++k)
+    {
+        Queue& other = *queues[(queue + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+
+        if (!other.tasks.empty())
+        {
+            task = other.tasks.front();
+            other.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+@brief Runs a task taken with take_task and wakes the owner of the job after its last task. The exception of
+a task is kept in its job
+@param task The task
+*/
+void ThreadPool::execute(const Task& task)
+{
+    Job* job = task.job;
+
+    if (!job->failed.load(std::memory_order_acquire))
+    {
+        try
+        {
+            (*job->function)(task.index);
+        }
+        catch (...)
+        {
+            if (!job->failed.exchange(true, std::memory_order_acq_rel))
+            {
+                job->error = std::current_exception();
+            }
+        }
+    }
+
+    // The owner returns once the last task finishes, the job is not read after it
+    const size_t count = job->count;
+
+    if (job->finished.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+    {
+        // The owner checks the counter with the mutex locked, so it is either awake or already waiting
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+
+        work_condition.notify_all();
+    }
+}
@@ -0,0 +1,224 @@
+#include <TiedNeuralNetwork.hpp>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+
+namespace
+{
+    /**
+    @brief Adds the gradients of a chunk of pixels. With z = wa*r + wb*g + wc*b, h = Hidden(z) and o = Output(w*h):
+    dE/dwd = (o - t) * Output'(o) * h and dE/dwa = sum((o - t) * Output'(o) * w) * Hidden'(h) * r
+    @param weights The weights wa, wb, wc, wd, we, wf
+    @param input The first input value. Three values per pixel
+    @param output The first output value. Three values per pixel
+    @param desired The first desired value. Three values per pixel
+    @param hidden The first hidden value. One value per pixel
+    @param counts The first amount of pixels each pixel stands for, nullptr for one each
+    @param pixels The amount of pixels
+    @return The gradients in the order of the weights and the error
+    */
+    template <class Hidden, class Output>
+    std::array<double, 7> chunk_gradients(const float* weights, const float* input, const float* output, const float* desired, const float* hidden, const float* counts, size_t pixels)
+    {
+        std::array<double, 7> sums {};
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            const float h = hidden[i];
+            const float count = counts != nullptr ? counts[i] : 1.f;
+            float back = 0.f;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                const float difference = output[k] - desired[k];
+                const float output_delta = count * difference * Output::derivate(output[k]);
+
+                sums[3 + k] += output_delta * h;
+                sums[6] += 0.5 * count * difference * difference;
+                back += output_delta * weights[3 + k];
+            }
+
+            const float hidden_delta = back * Hidden::derivate(h);
+
+            sums[0] += hidden_delta * input[0];
+            sums[1] += hidden_delta * input[1];
+            sums[2] += hidden_delta * input[2];
+
+            input += 3;
+            output += 3;
+            desired += 3;
+        }
+
+        return sums;
+    }
+}
+
+/**
+@brief Creates a network with random parameters
+@param first_layer_neurons The amount of neurons in the input layer
+*/
+TiedNeuralNetwork::TiedNeuralNetwork(uint32_t first_layer_neurons)
+{
+    parameters.wa = random_weight();
+    parameters.wb = random_weight();
+    parameters.wc = random_weight();
+    parameters.wd = random_weight();
+    parameters.we = random_weight();
+    parameters.wf = random_weight();
+
+    parameters.first_layer_neurons = first_layer_neurons;
+}
+
+/**
+@brief Creates a network with the data of a file
+@param path The path of the file with the data
+*/
+TiedNeuralNetwork::TiedNeuralNetwork(std::string path)
+{
+    std::ifstream stream;
+
+    stream.open(path);
+    std::string content;
+    std::getline(stream, content);
+    stream.close();
+
+    parameters.read(content);
+}
+
+/**
+@brief Export the network data to a file
+@param path The path of the file where the data will be exported
+*/
+void TiedNeuralNetwork::export_network(std::string path)
+{
+    std::ofstream stream(path.c_str());
+
+    std::cout << std::endl << parameters.to_string();
+
+    stream << parameters.to_string();
+
+    stream.close();
+}
+
+/**
+@brief Calculates the output of the network. The hidden values are not kept.
+The amount of pixels is the one of the inputs, the outputs are resized to it
+@param inputs The input values, three per pixel
+@param outputs The collection where the output values will be stored
+*/
+void TiedNeuralNetwork::feed_forward(const std::vector<float>& inputs, std::vector<float>& outputs) const
+{
+    outputs.resize(inputs.size());
+
+    compile().run(inputs.data(), outputs.data(), nullptr, inputs.size() / 3, ThreadPool::get());
+}
+
+/**
+@brief Calculates the output of the network keeping the hidden values for a later back propagation.
+The amount of pixels is the one of the inputs, so the colours of a ColorHistogram can be passed. The outputs
+are resized to it
+@param inputs The input values, three per pixel
+@param outputs The collection where the output values will be stored
+@param scratch The buffers where the hidden values are stored
+*/
+void TiedNeuralNetwork::feed_forward(const std::vector<float>& inputs, std::vector<float>& outputs, Scratch& scratch) const
+{
+    scratch.resize(uint32_t(inputs.size()));
+    outputs.resize(inputs.size());
+
+    compile().run(inputs.data(), outputs.data(), scratch.hidden_values.data(), scratch.hidden_values.size(), ThreadPool::get());
+}
+
+/**
+@brief Calculates the backpropagation: a gradient descent step of the tied weights with the mean of the
+gradients of compute_gradients
+@param inputs The input values of the feed_forward process
+@param output The output values of the feed_forward process
+@param desired The desired values
+@param scratch The buffers filled by the feed_forward process
+@param counts The amount of pixels each pixel stands for, as in a ColorHistogram. nullptr for one each
+@return The gradients and the error before the step
+*/
+TiedNeuralNetwork::Gradients TiedNeuralNetwork::back_propagation(const std::vector<float>& inputs, const std::vector<float>& output, const std::vector<float>& desired, const Scratch& scratch, const float* counts)
+{
+    const Gradients gradients = compute_gradients(inputs, output, desired, scratch, counts);
+
+    if (gradients.pixels == 0)
+    {
+        return gradients;
+    }
+
+    const double step = learning_rate / double(gradients.pixels);
+
+    parameters.wa -= float(step * gradients.weights[0]);
+    parameters.wb -= float(step * gradients.weights[1]);
+    parameters.wc -= float(step * gradients.weights[2]);
+    parameters.wd -= float(step * gradients.weights[3]);
+    parameters.we -= float(step * gradients.weights[4]);
+    parameters.wf -= float(step * gradients.weights[5]);
+
+    return gradients;
+}
+
+/**
+@brief Calculates the gradients of the squared error with respect to the tied weights, using the derivates
+of the activations. The sums are reduced with a fixed tree, so they do not depend on the threads.
+@param inputs The input values of the feed_forward process
+@param output The output values of the feed_forward process
+@param desired The desired values
+@param scratch The buffers filled by the feed_forward process
+@param counts The amount of pixels each pixel stands for, as in a ColorHistogram. nullptr for one each
+@return The gradients and the error of the pass
+*/
+TiedNeuralNetwork::Gradients TiedNeuralNetwork::compute_gradients(const std::vector<float>& inputs, const std::vector<float>& output, const std::vector<float>& desired, const Scratch& scratch, const float* counts) const
+{
+    const float weights[6] = {parameters.wa, parameters.wb, parameters.wc, parameters.wd, parameters.we, parameters.wf};
+    const size_t pixels = scratch.hidden_values.size();
+
+    std::vector<std::array<double, 7>> partials(ThreadPool::get_chunks_count(pixels));
+
+    NNActivations::dispatch(hidden_activation, [&](auto hidden)
+    {
+        NNActivations::dispatch(output_activation, [&](auto output_policy)
+        {
+            ThreadPool::get().parallel_for(pixels, [&](size_t chunk, size_t begin, size_t end)
+            {
+                partials[chunk] = chunk_gradients<decltype(hidden), decltype(output_policy)>(
+                                    weights,
+                                    inputs.data() + begin * 3,
+                                    output.data() + begin * 3,
+                                    desired.data() + begin * 3,
+                                    scratch.hidden_values.data() + begin,
+                                    counts != nullptr ? counts + begin : nullptr,
+                                    end - begin
+                                  );
+            });
+        });
+    });
+
+    const std::array<double, 7> sums = ThreadPool::tree_reduce(partials);
+
+    Gradients gradients;
+
+    for (int k = 0; k < 6; ++k)
+    {
+        gradients.weights[k] = sums[k];
+    }
+
+    gradients.error = sums[6];
+    gradients.pixels = pixels;
+
+    if (counts != nullptr)
+    {
+        double represented = 0.0;
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            represented += counts[i];
+        }
+
+        gradients.pixels = uint64_t(represented);
+    }
+
+    return gradients;
+}
@@ -1,12 +1,43 @@
 
 #include <NeuralNetworkApplication.hpp>
+#include <NNRandom.hpp>
+#include <NNFastMath.hpp>
 #include <ctime>
 #include <random>
+#include <string>
 
 int main(int argc, char *argv[])
 {
-    srand(time(NULL));    
+    // Checks the fast activations against their documented bounds without the menu, the exit code is 1 on failure
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--check-math")
+        {
+            return NNFastMath::check_accuracy(std::cout) ? 0 : 1;
+        }
+    }
+
+    // Every random value of the run comes from this seed. It is logged so the run can be replayed with --seed <seed>
+    uint64_t seed = NNRandom::generate_seed();
+
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--seed")
+        {
+            seed = std::stoull(argv[i + 1]);
+        }
+    }
+
+    NNRandom::set_seed(seed);
+    std::cout << "Seed: " << seed << std::endl;
 
     NeuralNetworkApplication a(argc, argv);
+
+    // The islands launched by the genetic training only run the training
+    if (a.is_launched_island())
+    {
+        return 0;
+    }
+
     return a.exec();
 }